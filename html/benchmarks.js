@@ -42,7 +42,8 @@ $(function() {
     }
 
     function plot_scalability(div, results) {
-        const [max_lin, max_log] = $(div).data("ylim").split(";").map(parseFloat);
+        // The machine comparison charts have no data-ylim and scale automatically.
+        const [max_lin, max_log] = String($(div).data("ylim") || ";").split(";").map(v => parseFloat(v) || undefined);
 
         const modes = [
             {
@@ -218,10 +219,168 @@ $(function() {
         createChart("bar");
     };
 
+    // The line colour of a queue, the spsc pattern colour for the SPSC queues.
+    function line_color(s) {
+        return s[0].pattern ? s[0].pattern.color : s[0];
+    }
+
+    // results: {name: [[percentile, nanoseconds], ...]} from scripts/percentiles_to_json.py.
+    function plot_percentiles(div, results) {
+        const series = [];
+        let categories = [];
+        for(const [name, s] of Object.entries(settings)) {
+            const data = results[name];
+            if(!data)
+                continue;
+            categories = data.map(a => a[0]);
+            series.push({
+                name: name,
+                color: line_color(s),
+                index: s[1],
+                type: "line",
+                data: data.map(a => a[1]),
+            });
+        }
+        Highcharts.chart(div, {
+            series: series,
+            xAxis: { categories: categories, title: { text: 'percentile, 1 producer, 1 consumer' } },
+            yAxis: { type: 'logarithmic', title: { text: 'latency, nanoseconds (logarithmic scale)' } },
+            tooltip: { shared: true, valueSuffix: ' ns' },
+        });
+    }
+
+    // results: {"name,threads": [[x, min, max, mean, stdev], ...]} from scripts/capacity_to_json.py and scripts/payload_to_json.py.
+    // Only the series of 1 and 2 producers and consumers are visible initially, the legend toggles the others.
+    function plot_sweep(div, results, x_title) {
+        const series = [];
+        for(const [key, stats] of Object.entries(results)) {
+            const i = key.lastIndexOf(",");
+            const s = settings[key.slice(0, i)];
+            if(i < 0 || !s)
+                continue;
+            const n_threads = parseInt(key.slice(i + 1));
+            series.push({
+                name: key,
+                color: line_color(s),
+                index: s[1] * 1000 + n_threads,
+                type: "line",
+                visible: n_threads <= 2,
+                dashStyle: n_threads > 1 ? 'ShortDash' : 'Solid',
+                data: stats.map(a => [a[0], a[3]]),
+            });
+        }
+        Highcharts.chart(div, {
+            series: series,
+            xAxis: { type: 'logarithmic', title: { text: x_title } },
+            yAxis: { type: 'logarithmic', title: { text: 'throughput, msg/sec (logarithmic scale)' } },
+            tooltip: { shared: true, formatter: function() {
+                const rows = this.points.map(p => `<tr><td style="color: ${p.series.color}">${p.series.name}: </td><td><strong>${prec0(p.y)}</strong></td></tr>`).join('\n');
+                return `<span class="tooltip_scalability_title">${prec0(this.x)}</span><table class="tooltip_scalability"><tbody>${rows}</tbody></table>`;
+            }},
+        });
+    }
+
+    // results: {commits: [[git_hash, time], ...], unit: {name: [value or null for each commit]}} from scripts/history_to_json.py.
+    function plot_history(div, results, unit) {
+        const commits = results.commits || [];
+        const series = [];
+        for(const [name, s] of Object.entries(settings)) {
+            const data = (results[unit] || {})[name];
+            if(!data)
+                continue;
+            series.push({
+                name: name,
+                color: line_color(s),
+                index: s[1],
+                type: "line",
+                connectNulls: true,
+                data: data,
+            });
+        }
+        Highcharts.chart(div, {
+            series: series,
+            xAxis: {
+                categories: commits.map(([git_hash, time]) => `${git_hash.slice(0, 7)}<br/>${(time || "").slice(0, 10)}`),
+                title: { text: 'commit, oldest first' }
+            },
+            yAxis: { title: { text: unit === "msg/sec" ? 'throughput, msg/sec, 1 producer, 1 consumer' : 'latency, nanoseconds/round-trip' } },
+            tooltip: { shared: true, valueSuffix: ` ${unit}` },
+        });
+    }
+
+    // The host descriptions of benchmark results converted from the benchmarks JSON output.
+    function host_caption(hosts) {
+        return hosts.map(h => `${h.cpu_model}, TSC ${(h.tsc_hz / 1e9).toFixed(3)} GHz, ${h.compiler}, commit ${h.git_hash || "unknown"}`).join("<br/>");
+    }
+
+    // The machine comparison: the results of one kind of two machines side by side. The results of kind K of machine M with
+    // SMT are in atomic_queue_benchmarks.smt_K_M, without SMT in cc_K_M.
+    const compare_views = {
+        latency:             { title: "Ping-pong latency",               kind: "latency",     plot: plot_latency },
+        scalability:         { title: "Throughput scalability",          kind: "scalability", plot: plot_scalability },
+        percentiles:         { title: "Latency percentiles",             kind: "percentiles", plot: plot_percentiles },
+        capacity:            { title: "Throughput versus capacity",      kind: "capacity",    plot: (div, r) => plot_sweep(div, r, 'queue capacity, elements') },
+        payload:             { title: "Throughput versus payload size",  kind: "payload",     plot: (div, r) => plot_sweep(div, r, 'element size, bytes') },
+        history_throughput:  { title: "Throughput history",              kind: "history",     plot: (div, r) => plot_history(div, r, "msg/sec") },
+        history_latency:     { title: "Latency history",                 kind: "history",     plot: (div, r) => plot_history(div, r, "ns/round-trip") },
+    };
+
+    function compare_machines(kind) {
+        const machines = [];
+        for(const id of Object.keys(atomic_queue_benchmarks)) {
+            const m = id.match(/^(cc|smt)_([a-z]+)_(.+)$/);
+            if(m && m[2] === kind)
+                machines.push({ id: id, name: `${m[3].replace(/_/g, " ")} ${m[1] === "smt" ? "with SMT" : "without SMT"}` });
+        }
+        return machines;
+    }
+
+    function plot_compare(side) {
+        const view = compare_views[$("#compare_view").val()];
+        const div = document.getElementById(`compare_chart_${side}`);
+        const id = $(`#compare_${side}`).val();
+        const results = id && atomic_queue_benchmarks[id];
+        const chart = Highcharts.charts.find(c => c && c.renderTo === div);
+        if(chart)
+            chart.destroy();
+        $(div).empty();
+        if(!results) {
+            $(div).html(`<p>No ${view.title.toLowerCase()} results.</p>`);
+            $(div).next("p.host").empty();
+            return;
+        }
+        view.plot(div, results);
+        $(div).next("p.host").html(results.host ? host_caption(results.host) : "");
+    }
+
+    function update_compare() {
+        const machines = compare_machines(compare_views[$("#compare_view").val()].kind);
+        ["left", "right"].forEach((side, i) => {
+            const select = $(`#compare_${side}`);
+            const selected = select.val();
+            select.empty().append(machines.map(m => $("<option>").val(m.id).text(m.name)));
+            if(machines.some(m => m.id === selected))
+                select.val(selected);
+            else if(machines.length)
+                select.val(machines[Math.min(i, machines.length - 1)].id);
+            plot_compare(side);
+        });
+    }
+
+    $("#compare_view")
+        .append(Object.entries(compare_views).map(([key, view]) => $("<option>").val(key).text(view.title)))
+        .on("change", update_compare);
+    $("#compare_left").on("change", () => plot_compare("left"));
+    $("#compare_right").on("change", () => plot_compare("right"));
+    update_compare();
+
     $("div.chart").each(function() {
         const id = this.id;
+        const results = atomic_queue_benchmarks[id];
         const plot_fn = id.includes("latency") ? plot_latency : plot_scalability;
-        plot_fn(this, atomic_queue_benchmarks[id]);
+        plot_fn(this, results);
+        if(results.host)
+            $(this).after(`<p class="host">${host_caption(results.host)}</p>`);
     });
 
     $(".view-toggle")
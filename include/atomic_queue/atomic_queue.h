@@ -5,6 +5,7 @@
 // Copyright (c) 2019 Maxim Egorushkin. MIT License. See the full licence in file LICENSE.
 
 #include "defs.h"
+#include "stats.h"
 
 #include <algorithm>
 #include <cassert>
@@ -299,6 +300,7 @@ protected:
                 element = q_element.load(A);
                 if(ATOMIC_QUEUE_LIKELY(element != NIL))
                     break;
+                Derived::stats_type::pop_spin();
                 if(Derived::maximize_throughput_)
                     spin_loop_pause();
             }
@@ -310,9 +312,10 @@ protected:
                 if(ATOMIC_QUEUE_LIKELY(element != NIL))
                     break;
                 // Do speculative loads while busy-waiting to avoid broadcasting RFO messages.
-                do
+                do {
+                    Derived::stats_type::pop_spin();
                     spin_loop_pause();
-                while(ATOMIC_QUEUE_UNLIKELY(Derived::maximize_throughput_ && q_element.load(X) == NIL));
+                } while(ATOMIC_QUEUE_UNLIKELY(Derived::maximize_throughput_ && q_element.load(X) == NIL));
             }
         }
         return element;
@@ -325,17 +328,20 @@ protected:
         auto& q_element = elements[index];
 
         if(Derived::spsc_) {
-            while(ATOMIC_QUEUE_UNLIKELY(q_element.load(A) != NIL)) // Hint the branch as not taken when the queue is not full.
+            while(ATOMIC_QUEUE_UNLIKELY(q_element.load(A) != NIL)) { // Hint the branch as not taken when the queue is not full.
+                Derived::stats_type::push_spin();
                 if(Derived::maximize_throughput_)
                     spin_loop_pause();
+            }
             q_element.store(element, R);
         }
         else {
             T expected;
             while(ATOMIC_QUEUE_UNLIKELY(!q_element.compare_exchange_weak((expected = NIL), element, AR, X))) // Hint the branch as not taken when the queue is not full.
-                do // Do speculative loads while busy-waiting to avoid broadcasting RFO messages.
+                do { // Do speculative loads while busy-waiting to avoid broadcasting RFO messages.
+                    Derived::stats_type::push_spin();
                     spin_loop_pause(); // (1) Wait for store (2) to complete.
-                while(ATOMIC_QUEUE_UNLIKELY(Derived::maximize_throughput_ && q_element.load(X) != NIL));
+                } while(ATOMIC_QUEUE_UNLIKELY(Derived::maximize_throughput_ && q_element.load(X) != NIL));
         }
     }
 
@@ -344,17 +350,20 @@ protected:
         auto& state = states[index];
 
         if(Derived::spsc_) {
-            while(ATOMIC_QUEUE_UNLIKELY(state.load(A) != STORED)) // Hint the branch as not taken when the queue is not empty.
+            while(ATOMIC_QUEUE_UNLIKELY(state.load(A) != STORED)) { // Hint the branch as not taken when the queue is not empty.
+                Derived::stats_type::pop_spin();
                 if(Derived::maximize_throughput_)
                     spin_loop_pause();
+            }
         }
         else {
             State expected, desired = LOADING;
             ATOMIC_QUEUE_LEAN_REG(desired);
             while(ATOMIC_QUEUE_UNLIKELY(!state.compare_exchange_weak((expected = STORED), desired, A, X))) { // Hint the branch as not taken when the queue is not empty.
-                do // Do speculative loads while busy-waiting to avoid broadcasting RFO messages.
+                do { // Do speculative loads while busy-waiting to avoid broadcasting RFO messages.
+                    Derived::stats_type::pop_spin();
                     spin_loop_pause();
-                while(ATOMIC_QUEUE_UNLIKELY(Derived::maximize_throughput_ && state.load(X) != STORED));
+                } while(ATOMIC_QUEUE_UNLIKELY(Derived::maximize_throughput_ && state.load(X) != STORED));
                 ATOMIC_QUEUE_LEAN_REG(desired);
             }
         }
@@ -369,17 +378,20 @@ protected:
         auto& state = states[index];
 
         if(Derived::spsc_) {
-            while(ATOMIC_QUEUE_UNLIKELY(state.load(A) != EMPTY)) // Hint the branch as not taken when the queue is not full.
+            while(ATOMIC_QUEUE_UNLIKELY(state.load(A) != EMPTY)) { // Hint the branch as not taken when the queue is not full.
+                Derived::stats_type::push_spin();
                 if(Derived::maximize_throughput_)
                     spin_loop_pause();
+            }
         }
         else {
             State expected, desired = STORING;
             ATOMIC_QUEUE_LEAN_REG(desired);
             while(ATOMIC_QUEUE_UNLIKELY(!state.compare_exchange_weak((expected = EMPTY), desired, A, X))) {// Hint the branch as not taken when the queue is not full.
-                do // Do speculative loads while busy-waiting to avoid broadcasting RFO messages.
+                do { // Do speculative loads while busy-waiting to avoid broadcasting RFO messages.
+                    Derived::stats_type::push_spin();
                     spin_loop_pause();
-                while(ATOMIC_QUEUE_UNLIKELY(Derived::maximize_throughput_ && state.load(X) != EMPTY));
+                } while(ATOMIC_QUEUE_UNLIKELY(Derived::maximize_throughput_ && state.load(X) != EMPTY));
                 ATOMIC_QUEUE_LEAN_REG(desired);
             }
         }
@@ -392,17 +404,28 @@ public:
     template<class T>
     ATOMIC_QUEUE_INLINE bool try_push(T&& element) noexcept {
         auto head = head_.load(X);
+        unsigned tail;
         if(Derived::spsc_) {
-            if(ATOMIC_QUEUE_UNLIKELY(as_signed(head - tail_.load(X)) >= as_signed(downcast().size_)))
+            tail = tail_.load(X);
+            if(ATOMIC_QUEUE_UNLIKELY(as_signed(head - tail) >= as_signed(downcast().size_))) {
+                Derived::stats_type::try_push_failure();
                 return false;
+            }
             head_.store(head + 1, X);
         }
         else {
-            do {
-                if(ATOMIC_QUEUE_UNLIKELY(as_signed(head - tail_.load(X)) >= as_signed(downcast().size_)))
+            for(;;) {
+                tail = tail_.load(X);
+                if(ATOMIC_QUEUE_UNLIKELY(as_signed(head - tail) >= as_signed(downcast().size_))) {
+                    Derived::stats_type::try_push_failure();
                     return false;
-            } while(ATOMIC_QUEUE_UNLIKELY(!head_.compare_exchange_weak(head, head + 1, X, X))); // This loop is not FIFO.
+                }
+                if(ATOMIC_QUEUE_LIKELY(head_.compare_exchange_weak(head, head + 1, X, X))) // This loop is not FIFO.
+                    break;
+                Derived::stats_type::push_cas_failure();
+            }
         }
+        Derived::stats_type::size(head + 1 - tail);
 
         downcast().do_push(std::forward<T>(element), head);
         return true;
@@ -412,15 +435,22 @@ public:
     ATOMIC_QUEUE_INLINE bool try_pop(T& element) noexcept {
         auto tail = tail_.load(X);
         if(Derived::spsc_) {
-            if(ATOMIC_QUEUE_UNLIKELY(as_signed(head_.load(X) - tail) <= 0))
+            if(ATOMIC_QUEUE_UNLIKELY(as_signed(head_.load(X) - tail) <= 0)) {
+                Derived::stats_type::try_pop_failure();
                 return false;
+            }
             tail_.store(tail + 1, X);
         }
         else {
-            do {
-                if(ATOMIC_QUEUE_UNLIKELY(as_signed(head_.load(X) - tail) <= 0))
+            for(;;) {
+                if(ATOMIC_QUEUE_UNLIKELY(as_signed(head_.load(X) - tail) <= 0)) {
+                    Derived::stats_type::try_pop_failure();
                     return false;
-            } while(ATOMIC_QUEUE_UNLIKELY(!tail_.compare_exchange_weak(tail, tail + 1, X, X))); // This loop is not FIFO.
+                }
+                if(ATOMIC_QUEUE_LIKELY(tail_.compare_exchange_weak(tail, tail + 1, X, X))) // This loop is not FIFO.
+                    break;
+                Derived::stats_type::pop_cas_failure();
+            }
         }
 
         element = downcast().do_pop(tail);
@@ -438,6 +468,8 @@ public:
             constexpr auto memory_order = Derived::total_order_ ? std::memory_order_seq_cst : std::memory_order_relaxed;
             head = head_.fetch_add(1, memory_order); // FIFO and total order on Intel regardless, as of 2019.
         }
+        if(Derived::stats_type::enabled) // Loading tail_ here is not free, only do that when counting.
+            Derived::stats_type::size(head + 1 - tail_.load(X));
         downcast().do_push(std::forward<T>(element), head);
     }
 
@@ -475,13 +507,18 @@ public:
     ATOMIC_QUEUE_SINLINE constexpr bool is_spsc() noexcept {
         return Derived::spsc_;
     }
+
+    // The hot-path statistics of all queues with the same STATS policy. All zeros for the default NoStats policy.
+    ATOMIC_QUEUE_SINLINE StatsSnapshot stats() noexcept {
+        return Derived::stats_type::snapshot();
+    }
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-template<class T, unsigned SIZE, T NIL = details::nil<T>(), bool MINIMIZE_CONTENTION = true, bool MAXIMIZE_THROUGHPUT = true, bool TOTAL_ORDER = false, bool SPSC = false>
-class AtomicQueue : public AtomicQueueCommon<AtomicQueue<T, SIZE, NIL, MINIMIZE_CONTENTION, MAXIMIZE_THROUGHPUT, TOTAL_ORDER, SPSC>> {
-    using Base = AtomicQueueCommon<AtomicQueue<T, SIZE, NIL, MINIMIZE_CONTENTION, MAXIMIZE_THROUGHPUT, TOTAL_ORDER, SPSC>>;
+template<class T, unsigned SIZE, T NIL = details::nil<T>(), bool MINIMIZE_CONTENTION = true, bool MAXIMIZE_THROUGHPUT = true, bool TOTAL_ORDER = false, bool SPSC = false, class STATS = NoStats>
+class AtomicQueue : public AtomicQueueCommon<AtomicQueue<T, SIZE, NIL, MINIMIZE_CONTENTION, MAXIMIZE_THROUGHPUT, TOTAL_ORDER, SPSC, STATS>> {
+    using Base = AtomicQueueCommon<AtomicQueue<T, SIZE, NIL, MINIMIZE_CONTENTION, MAXIMIZE_THROUGHPUT, TOTAL_ORDER, SPSC, STATS>>;
     friend Base;
 
     static constexpr unsigned size_ = MINIMIZE_CONTENTION ? details::round_up_to_power_of_2(SIZE) : SIZE;
@@ -506,6 +543,7 @@ class AtomicQueue : public AtomicQueueCommon<AtomicQueue<T, SIZE, NIL, MINIMIZE_
 
 public:
     using value_type = T;
+    using stats_type = STATS;
 
     AtomicQueue() noexcept {
         assert(std::atomic<T>{NIL}.is_lock_free()); // Queue element type T is not atomic. Use AtomicQueue2/AtomicQueueB2 for such element types.
@@ -519,9 +557,9 @@ public:
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-template<class T, unsigned SIZE, bool MINIMIZE_CONTENTION = true, bool MAXIMIZE_THROUGHPUT = true, bool TOTAL_ORDER = false, bool SPSC = false>
-class AtomicQueue2 : public AtomicQueueCommon<AtomicQueue2<T, SIZE, MINIMIZE_CONTENTION, MAXIMIZE_THROUGHPUT, TOTAL_ORDER, SPSC>> {
-    using Base = AtomicQueueCommon<AtomicQueue2<T, SIZE, MINIMIZE_CONTENTION, MAXIMIZE_THROUGHPUT, TOTAL_ORDER, SPSC>>;
+template<class T, unsigned SIZE, bool MINIMIZE_CONTENTION = true, bool MAXIMIZE_THROUGHPUT = true, bool TOTAL_ORDER = false, bool SPSC = false, class STATS = NoStats>
+class AtomicQueue2 : public AtomicQueueCommon<AtomicQueue2<T, SIZE, MINIMIZE_CONTENTION, MAXIMIZE_THROUGHPUT, TOTAL_ORDER, SPSC, STATS>> {
+    using Base = AtomicQueueCommon<AtomicQueue2<T, SIZE, MINIMIZE_CONTENTION, MAXIMIZE_THROUGHPUT, TOTAL_ORDER, SPSC, STATS>>;
     friend Base;
 
     static constexpr unsigned size_ = MINIMIZE_CONTENTION ? details::round_up_to_power_of_2(SIZE) : SIZE;
@@ -547,6 +585,7 @@ class AtomicQueue2 : public AtomicQueueCommon<AtomicQueue2<T, SIZE, MINIMIZE_CON
 
 public:
     using value_type = T;
+    using stats_type = STATS;
 
     AtomicQueue2() noexcept = default;
     AtomicQueue2(AtomicQueue2 const&) = delete;
@@ -555,11 +594,11 @@ public:
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-template<class T, class A = std::allocator<T>, T NIL = details::nil<T>(), bool MAXIMIZE_THROUGHPUT = true, bool TOTAL_ORDER = false, bool SPSC = false>
+template<class T, class A = std::allocator<T>, T NIL = details::nil<T>(), bool MAXIMIZE_THROUGHPUT = true, bool TOTAL_ORDER = false, bool SPSC = false, class STATS = NoStats>
 class AtomicQueueB : private std::allocator_traits<A>::template rebind_alloc<std::atomic<T>>,
-                     public AtomicQueueCommon<AtomicQueueB<T, A, NIL, MAXIMIZE_THROUGHPUT, TOTAL_ORDER, SPSC>> {
+                     public AtomicQueueCommon<AtomicQueueB<T, A, NIL, MAXIMIZE_THROUGHPUT, TOTAL_ORDER, SPSC, STATS>> {
     using AllocatorElements = typename std::allocator_traits<A>::template rebind_alloc<std::atomic<T>>;
-    using Base = AtomicQueueCommon<AtomicQueueB<T, A, NIL, MAXIMIZE_THROUGHPUT, TOTAL_ORDER, SPSC>>;
+    using Base = AtomicQueueCommon<AtomicQueueB<T, A, NIL, MAXIMIZE_THROUGHPUT, TOTAL_ORDER, SPSC, STATS>>;
     friend Base;
 
     static constexpr bool total_order_ = TOTAL_ORDER;
@@ -597,6 +636,7 @@ class AtomicQueueB : private std::allocator_traits<A>::template rebind_alloc<std
 
 public:
     using value_type = T;
+    using stats_type = STATS;
     using allocator_type = A;
 
     // The special member functions are not thread-safe.
@@ -648,11 +688,11 @@ public:
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-template<class T, class A = std::allocator<T>, bool MAXIMIZE_THROUGHPUT = true, bool TOTAL_ORDER = false, bool SPSC = false>
+template<class T, class A = std::allocator<T>, bool MAXIMIZE_THROUGHPUT = true, bool TOTAL_ORDER = false, bool SPSC = false, class STATS = NoStats>
 class AtomicQueueB2 : private std::allocator_traits<A>::template rebind_alloc<unsigned char>,
-                      public AtomicQueueCommon<AtomicQueueB2<T, A, MAXIMIZE_THROUGHPUT, TOTAL_ORDER, SPSC>> {
+                      public AtomicQueueCommon<AtomicQueueB2<T, A, MAXIMIZE_THROUGHPUT, TOTAL_ORDER, SPSC, STATS>> {
     using StorageAllocator = typename std::allocator_traits<A>::template rebind_alloc<unsigned char>;
-    using Base = AtomicQueueCommon<AtomicQueueB2<T, A, MAXIMIZE_THROUGHPUT, TOTAL_ORDER, SPSC>>;
+    using Base = AtomicQueueCommon<AtomicQueueB2<T, A, MAXIMIZE_THROUGHPUT, TOTAL_ORDER, SPSC, STATS>>;
     friend Base;
 
     static constexpr bool total_order_ = TOTAL_ORDER;
@@ -703,6 +743,7 @@ class AtomicQueueB2 : private std::allocator_traits<A>::template rebind_alloc<un
 
 public:
     using value_type = T;
+    using stats_type = STATS;
     using allocator_type = A;
 
     // The special member functions are not thread-safe.
@@ -6,6 +6,8 @@
 
 #include "defs.h"
 
+#include <cassert>
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 namespace atomic_queue {
@@ -47,6 +49,79 @@ struct Barrier2 {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// A sense-reversing combining tree barrier.
+//
+// Barrier2 has every thread decrement the same counter, so that the cache line with the counter is handed over between all
+// threads serially, one at a time, which staggers the release of the threads. Here, each group of up to FAN_IN threads
+// decrement a counter in its own tree node, on its own cache line. The last thread to arrive at a node proceeds to the
+// parent node, the last thread to arrive at the root node releases all threads with one store into sense_.
+//
+// The barrier is reusable. The tree is sized by the number of threads at construction time, MAX_THREADS limits the storage.
+template<unsigned MAX_THREADS = 1024, unsigned FAN_IN = 4>
+class TreeBarrier {
+    static_assert(FAN_IN > 1, "FAN_IN must be greater than 1.");
+
+    struct alignas(CACHE_LINE_SIZE) Node {
+        std::atomic<unsigned> arrived;
+        unsigned expected;
+        Node* parent;
+    };
+
+    static constexpr unsigned count_nodes(unsigned n) noexcept {
+        unsigned nodes = 0;
+        do nodes += n = (n + FAN_IN - 1) / FAN_IN;
+        while(n > 1);
+        return nodes;
+    }
+
+    // Waiting threads spin on their local copies of this cache line, which gets invalidated once per barrier episode.
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> sense_ = {};
+    Node nodes_[count_nodes(MAX_THREADS)];
+
+public:
+    static constexpr unsigned max_threads = MAX_THREADS;
+
+    explicit TreeBarrier(unsigned n_threads) noexcept {
+        assert(n_threads && n_threads <= MAX_THREADS);
+        Node* level = nodes_;
+        for(unsigned n = n_threads;;) {
+            unsigned const n_nodes = (n + FAN_IN - 1) / FAN_IN;
+            Node* const next_level = level + n_nodes;
+            for(unsigned i = 0; i < n_nodes; ++i) {
+                level[i].arrived.store(0, X);
+                level[i].expected = min_value(FAN_IN, n - i * FAN_IN);
+                level[i].parent = n_nodes > 1 ? next_level + i / FAN_IN : nullptr;
+            }
+            if(n_nodes == 1)
+                break;
+            level = next_level;
+            n = n_nodes;
+        }
+    }
+
+    TreeBarrier(TreeBarrier const&) = delete;
+    TreeBarrier& operator=(TreeBarrier const&) = delete;
+
+    // thread_idx must be unique for each thread in [0, n_threads).
+    // Returns true for the one thread which released the barrier.
+    ATOMIC_QUEUE_INLINE bool wait(unsigned thread_idx) noexcept {
+        // sense_ cannot flip before this thread arrives, a relaxed load reads the current episode value.
+        bool const sense = !sense_.load(X);
+        for(Node* node = nodes_ + thread_idx / FAN_IN; node; node = node->parent) {
+            if(node->arrived.fetch_add(1, AR) + 1 != node->expected) {
+                do spin_loop_pause();
+                while(sense_.load(A) != sense);
+                return false;
+            }
+            node->arrived.store(0, X); // All threads have arrived at this node. Reset it for the next episode.
+        }
+        sense_.store(sense, R); // Release all threads.
+        return true;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 } // namespace atomic_queue
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,132 @@
+/* -*- mode: c++; c-basic-offset: 4; indent-tabs-mode: nil; tab-width: 4 -*- */
+#ifndef ATOMIC_QUEUE_LATEST_VALUE_H_INCLUDED
+#define ATOMIC_QUEUE_LATEST_VALUE_H_INCLUDED
+
+// Copyright (c) 2019 Maxim Egorushkin. MIT License. See the full licence in file LICENSE.
+
+#include "seqlock.h"
+
+#include <cassert>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace atomic_queue {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// A seqlock cell holding the latest value, for consumers which only need the latest value rather than every update.
+//
+// A writer never waits for readers. Readers retry loading when a writer stores into the cell concurrently.
+// SINGLE_WRITER=false allows multiple writers, which then wait for each other, but never for readers.
+// Element type T must be trivially copyable. The cell holds a zero-initialized T until the first store.
+template<class T, bool SINGLE_WRITER = true>
+class LatestValue {
+    // The sequence number is odd while a writer is storing, it is twice the number of stores otherwise.
+    // Each cell occupies its own cache line(s) to avoid false sharing between adjacent cells.
+    alignas(CACHE_LINE_SIZE) std::atomic<unsigned> seq_ = {};
+    details::SeqlockStorage<T> value_;
+
+public:
+    using value_type = T;
+
+    LatestValue() noexcept = default;
+    LatestValue(LatestValue const&) = delete;
+    LatestValue& operator=(LatestValue const&) = delete;
+
+    ATOMIC_QUEUE_INLINE void store(T const& value) noexcept {
+        unsigned seq = seq_.load(X);
+        if(SINGLE_WRITER) {
+            details::seqlock_store_begin(seq_, seq + 1);
+        }
+        else {
+            for(;;) {
+                if(ATOMIC_QUEUE_UNLIKELY(seq & 1)) { // Another writer is storing.
+                    spin_loop_pause();
+                    seq = seq_.load(X);
+                }
+                else if(ATOMIC_QUEUE_LIKELY(seq_.compare_exchange_weak(seq, seq + 1, X, X))) {
+                    std::atomic_thread_fence(R); // Same as in seqlock_store_begin.
+                    break;
+                }
+            }
+        }
+        value_.store(value);
+        details::seqlock_store_end(seq_, seq + 2);
+    }
+
+    // Loads the value with one attempt. Returns false when a writer was storing concurrently.
+    ATOMIC_QUEUE_INLINE bool try_load(T& value) const noexcept {
+        unsigned const seq = seq_.load(A);
+        if(ATOMIC_QUEUE_UNLIKELY(seq & 1))
+            return false;
+        value_.load(value);
+        return details::seqlock_load_end(seq_, seq);
+    }
+
+    ATOMIC_QUEUE_INLINE T load() const noexcept {
+        T value;
+        while(ATOMIC_QUEUE_UNLIKELY(!try_load(value)))
+            spin_loop_pause();
+        return value;
+    }
+
+    // The number of stores completed so far. Readers can compare versions to detect updates without loading the value.
+    ATOMIC_QUEUE_INLINE unsigned version() const noexcept {
+        return seq_.load(A) / 2;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// A last-value cache: a table of LatestValue cells indexed by key, e.g. by instrument id.
+// Stores into different keys never contend, each cell occupies its own cache line(s).
+template<class T, unsigned SIZE, bool SINGLE_WRITER = true>
+class LatestValueTable {
+    LatestValue<T, SINGLE_WRITER> cells_[SIZE];
+
+public:
+    using value_type = T;
+    using cell_type = LatestValue<T, SINGLE_WRITER>;
+
+    LatestValueTable() noexcept = default;
+    LatestValueTable(LatestValueTable const&) = delete;
+    LatestValueTable& operator=(LatestValueTable const&) = delete;
+
+    ATOMIC_QUEUE_INLINE cell_type& operator[](unsigned key) noexcept {
+        assert(key < SIZE);
+        return cells_[key];
+    }
+
+    ATOMIC_QUEUE_INLINE cell_type const& operator[](unsigned key) const noexcept {
+        assert(key < SIZE);
+        return cells_[key];
+    }
+
+    ATOMIC_QUEUE_INLINE void store(unsigned key, T const& value) noexcept {
+        (*this)[key].store(value);
+    }
+
+    ATOMIC_QUEUE_INLINE bool try_load(unsigned key, T& value) const noexcept {
+        return (*this)[key].try_load(value);
+    }
+
+    ATOMIC_QUEUE_INLINE T load(unsigned key) const noexcept {
+        return (*this)[key].load();
+    }
+
+    ATOMIC_QUEUE_INLINE unsigned version(unsigned key) const noexcept {
+        return (*this)[key].version();
+    }
+
+    ATOMIC_QUEUE_SINLINE constexpr unsigned size() noexcept {
+        return SIZE;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace atomic_queue
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // ATOMIC_QUEUE_LATEST_VALUE_H_INCLUDED
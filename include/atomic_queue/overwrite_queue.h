@@ -0,0 +1,142 @@
+/* -*- mode: c++; c-basic-offset: 4; indent-tabs-mode: nil; tab-width: 4 -*- */
+#ifndef ATOMIC_QUEUE_OVERWRITE_QUEUE_H_INCLUDED
+#define ATOMIC_QUEUE_OVERWRITE_QUEUE_H_INCLUDED
+
+// Copyright (c) 2019 Maxim Egorushkin. MIT License. See the full licence in file LICENSE.
+
+#include "atomic_queue.h"
+#include "seqlock.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace atomic_queue {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// A lossy, conflating ring buffer for streams where only the freshest messages matter, e.g. market data quotes.
+//
+// When the queue is full, push overwrites the oldest message instead of waiting for the consumer. Producers never wait for the
+// consumer. The consumer detects that it has been lapped by the producers from the per-slot sequence numbers, skips ahead to
+// the oldest message remaining in the ring buffer and counts the skipped messages in dropped().
+//
+// SPSC=true for a single producer, SPSC=false for multiple producers. There is a single consumer in both cases.
+// Element type T must be trivially copyable: the consumer may load a slot while a producer stores into it.
+template<class T, unsigned SIZE, bool SPSC = false>
+class OverwriteQueue {
+    static constexpr unsigned size_ = details::round_up_to_power_of_2(SIZE);
+
+    // The sequence number of a slot storing message number n is 2n+1 while the element is being stored and 2n+2 once stored.
+    struct Slot {
+        std::atomic<unsigned> seq = {};
+        details::SeqlockStorage<T> element;
+    };
+
+    alignas(CACHE_LINE_SIZE) std::atomic<unsigned> head_ = {};
+    // Only the consumer modifies these.
+    alignas(CACHE_LINE_SIZE) std::atomic<unsigned> tail_ = {};
+    std::atomic<unsigned> dropped_ = {};
+    alignas(CACHE_LINE_SIZE) Slot slots_[size_];
+
+    ATOMIC_QUEUE_INLINE Slot& slot(unsigned n) noexcept {
+        return slots_[n & (size_ - 1)];
+    }
+
+public:
+    using value_type = T;
+
+    OverwriteQueue() noexcept = default;
+    OverwriteQueue(OverwriteQueue const&) = delete;
+    OverwriteQueue& operator=(OverwriteQueue const&) = delete;
+
+    ATOMIC_QUEUE_INLINE void push(T const& element) noexcept {
+        unsigned const head = SPSC ? head_.load(X) : head_.fetch_add(1, X);
+        if(SPSC)
+            head_.store(head + 1, X);
+        auto& s = slot(head);
+        unsigned const storing = 2 * head + 1;
+
+        if(SPSC) {
+            details::seqlock_store_begin(s.seq, storing);
+        }
+        else {
+            // Another producer may still be storing into this slot the message from size_ messages ago.
+            for(unsigned seq = s.seq.load(X);;) {
+                if(ATOMIC_QUEUE_UNLIKELY(as_signed(seq - storing) > 0))
+                    return; // A newer message has overwritten this slot already. The consumer counts this message as dropped.
+                if(ATOMIC_QUEUE_UNLIKELY(seq & 1)) {
+                    spin_loop_pause();
+                    seq = s.seq.load(X);
+                }
+                else if(ATOMIC_QUEUE_LIKELY(s.seq.compare_exchange_weak(seq, storing, X, X))) {
+                    std::atomic_thread_fence(R); // Same as in seqlock_store_begin.
+                    break;
+                }
+            }
+        }
+
+        s.element.store(element);
+        details::seqlock_store_end(s.seq, storing + 1);
+    }
+
+    // Only one consumer thread may call try_pop/pop. With multiple producers, try_pop returns false while the next message
+    // is yet to be stored by its producer, even if the subsequent messages have been stored by other producers.
+    ATOMIC_QUEUE_INLINE bool try_pop(T& element) noexcept {
+        for(unsigned tail = tail_.load(X);;) {
+            auto& s = slot(tail);
+            unsigned const stored = 2 * tail + 2;
+            unsigned const seq = s.seq.load(A);
+            int const lap = as_signed(seq - stored);
+            if(ATOMIC_QUEUE_LIKELY(lap < 0))
+                return false; // Message tail hasn't been stored yet.
+            if(ATOMIC_QUEUE_LIKELY(!lap)) {
+                s.element.load(element);
+                if(ATOMIC_QUEUE_LIKELY(details::seqlock_load_end(s.seq, seq))) {
+                    tail_.store(tail + 1, X);
+                    return true;
+                }
+            }
+            // The producers have overwritten message tail. Skip to the oldest message which may still be in the ring buffer.
+            unsigned const skip = max_value(as_signed(head_.load(X) - size_ - tail), 1);
+            dropped_.store(dropped_.load(X) + skip, X);
+            tail += skip;
+            tail_.store(tail, X);
+        }
+    }
+
+    ATOMIC_QUEUE_INLINE T pop() noexcept {
+        T element;
+        while(ATOMIC_QUEUE_UNLIKELY(!try_pop(element)))
+            spin_loop_pause();
+        return element;
+    }
+
+    // The total number of messages the consumer has skipped because the producers had overwritten them.
+    ATOMIC_QUEUE_INLINE unsigned dropped() const noexcept {
+        return dropped_.load(X);
+    }
+
+    ATOMIC_QUEUE_INLINE unsigned was_size() const noexcept {
+        unsigned n{head_.load(X) - tail_.load(X)};
+        return min_value(n, size_);
+    }
+
+    ATOMIC_QUEUE_INLINE bool was_empty() const noexcept {
+        return !was_size();
+    }
+
+    ATOMIC_QUEUE_SINLINE constexpr unsigned capacity() noexcept {
+        return size_;
+    }
+
+    ATOMIC_QUEUE_SINLINE constexpr bool is_spsc() noexcept {
+        return SPSC;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace atomic_queue
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // ATOMIC_QUEUE_OVERWRITE_QUEUE_H_INCLUDED
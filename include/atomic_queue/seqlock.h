@@ -0,0 +1,85 @@
+/* -*- mode: c++; c-basic-offset: 4; indent-tabs-mode: nil; tab-width: 4 -*- */
+#ifndef ATOMIC_QUEUE_SEQLOCK_H_INCLUDED
+#define ATOMIC_QUEUE_SEQLOCK_H_INCLUDED
+
+// Copyright (c) 2019 Maxim Egorushkin. MIT License. See the full licence in file LICENSE.
+
+#include "defs.h"
+
+#include <cstring>
+#include <type_traits>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace atomic_queue {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace details {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Element storage for a seqlock: a writer may store into it while readers load from it.
+//
+// The element is copied in and out with relaxed atomic word stores and loads, so that a racing load is not undefined behaviour.
+// On x86-64 these compile into plain mov instructions. A reader must validate the loaded copy with the sequence number.
+template<class T>
+class SeqlockStorage {
+    static_assert(std::is_trivially_copyable<T>::value, "Seqlock element type T must be trivially copyable.");
+
+    using Word = std::uintptr_t;
+    static constexpr unsigned N_WORDS = (sizeof(T) + sizeof(Word) - 1) / sizeof(Word);
+
+    std::atomic<Word> words_[N_WORDS] = {};
+
+public:
+    ATOMIC_QUEUE_INLINE void store(T const& element) noexcept {
+        Word w[N_WORDS] = {};
+        std::memcpy(w, &element, sizeof(T));
+        for(unsigned i = 0; i < N_WORDS; ++i)
+            words_[i].store(w[i], X);
+    }
+
+    ATOMIC_QUEUE_INLINE void load(T& element) const noexcept {
+        Word w[N_WORDS];
+        for(unsigned i = 0; i < N_WORDS; ++i)
+            w[i] = words_[i].load(X);
+        std::memcpy(&element, w, sizeof(T));
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The seqlock protocol over an external sequence number. Odd sequence numbers mark stores in progress.
+//
+// The writer:
+//     seqlock_store_begin(seq, odd_seq); storage.store(element); seqlock_store_end(seq, odd_seq + 1);
+//
+// A reader:
+//     auto s = seq.load(A); storage.load(element); valid if seqlock_load_end(seq, s) and s is even.
+
+ATOMIC_QUEUE_SINLINE void seqlock_store_begin(std::atomic<unsigned>& seq, unsigned odd_seq) noexcept {
+    seq.store(odd_seq, X);
+    std::atomic_thread_fence(R); // Don't let the following element stores become visible prior to the odd sequence number.
+}
+
+ATOMIC_QUEUE_SINLINE void seqlock_store_end(std::atomic<unsigned>& seq, unsigned even_seq) noexcept {
+    seq.store(even_seq, R);
+}
+
+ATOMIC_QUEUE_SINLINE bool seqlock_load_end(std::atomic<unsigned> const& seq, unsigned seq_begin) noexcept {
+    std::atomic_thread_fence(A); // Don't let the preceding element loads happen after reloading the sequence number.
+    return seq.load(X) == seq_begin;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace details
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace atomic_queue
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // ATOMIC_QUEUE_SEQLOCK_H_INCLUDED
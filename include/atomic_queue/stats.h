@@ -0,0 +1,160 @@
+/* -*- mode: c++; c-basic-offset: 4; indent-tabs-mode: nil; tab-width: 4 -*- */
+#ifndef ATOMIC_QUEUE_STATS_H_INCLUDED
+#define ATOMIC_QUEUE_STATS_H_INCLUDED
+
+// Copyright (c) 2019 Maxim Egorushkin. MIT License. See the full licence in file LICENSE.
+
+#include "defs.h"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace atomic_queue {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct StatsSnapshot {
+    std::uint64_t push_cas_failures; // head_ compare-exchange failures in try_push.
+    std::uint64_t pop_cas_failures;  // tail_ compare-exchange failures in try_pop.
+    std::uint64_t push_spins;        // Busy-wait iterations in push/try_push waiting for an element slot to become empty.
+    std::uint64_t pop_spins;         // Busy-wait iterations in pop/try_pop waiting for an element to be stored.
+    std::uint64_t try_push_failures; // try_push calls returning false because the queue was full.
+    std::uint64_t try_pop_failures;  // try_pop calls returning false because the queue was empty.
+    unsigned max_size;               // The maximum head_ - tail_ observed by producers.
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The default hot-path statistics policy for the queues. Compiles into nothing.
+struct NoStats {
+    static constexpr bool enabled = false;
+
+    ATOMIC_QUEUE_SINLINE void push_cas_failure() noexcept {}
+    ATOMIC_QUEUE_SINLINE void pop_cas_failure() noexcept {}
+    ATOMIC_QUEUE_SINLINE void push_spin() noexcept {}
+    ATOMIC_QUEUE_SINLINE void pop_spin() noexcept {}
+    ATOMIC_QUEUE_SINLINE void try_push_failure() noexcept {}
+    ATOMIC_QUEUE_SINLINE void try_pop_failure() noexcept {}
+    ATOMIC_QUEUE_SINLINE void size(unsigned) noexcept {}
+
+    static StatsSnapshot snapshot() noexcept { return {}; }
+    static void reset() noexcept {}
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The hot-path statistics policy which counts contention, full and empty queue events.
+//
+// Each thread increments its own counters on its own cache line with plain loads and stores, so that counting introduces no
+// atomic read-modify-write instructions and no false sharing. The counters of all threads are summed up in snapshot().
+// The counts of exited threads are retained.
+//
+// All queues with the same Stats type share the counters. Use distinct Tag types to count queues separately.
+template<class Tag = void>
+class Stats {
+    enum { PUSH_CAS_FAILURES, POP_CAS_FAILURES, PUSH_SPINS, POP_SPINS, TRY_PUSH_FAILURES, TRY_POP_FAILURES, N_COUNTERS };
+
+    struct alignas(CACHE_LINE_SIZE) Counters {
+        std::atomic<std::uint64_t> counters[N_COUNTERS] = {};
+        std::atomic<unsigned> max_size = {};
+
+        void add_to(Counters& c) const noexcept {
+            for(unsigned i = 0; i < N_COUNTERS; ++i)
+                c.counters[i].store(c.counters[i].load(X) + counters[i].load(X), X);
+            c.max_size.store(max_value(c.max_size.load(X), max_size.load(X)), X);
+        }
+
+        void clear() noexcept {
+            for(auto& counter : counters)
+                counter.store(0, X);
+            max_size.store(0, X);
+        }
+    };
+
+    struct Registry {
+        std::mutex mutex;
+        std::vector<Counters*> threads;
+        Counters exited; // The sum of the counters of exited threads.
+    };
+
+    ATOMIC_QUEUE_SINLINE Registry& registry() noexcept {
+        static Registry r; // Constructed before and destroyed after any ThreadCounters.
+        return r;
+    }
+
+    struct ThreadCounters : Counters {
+        ThreadCounters() {
+            Registry& r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.threads.push_back(this);
+        }
+
+        ~ThreadCounters() noexcept {
+            Registry& r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.threads.erase(std::find(r.threads.begin(), r.threads.end(), this));
+            this->add_to(r.exited);
+        }
+    };
+
+    ATOMIC_QUEUE_SINLINE Counters& local() noexcept {
+        static thread_local ThreadCounters c;
+        return c;
+    }
+
+    ATOMIC_QUEUE_SINLINE void increment(unsigned i) noexcept {
+        auto& counter = local().counters[i];
+        counter.store(counter.load(X) + 1, X);
+    }
+
+public:
+    static constexpr bool enabled = true;
+
+    ATOMIC_QUEUE_SINLINE void push_cas_failure() noexcept { increment(PUSH_CAS_FAILURES); }
+    ATOMIC_QUEUE_SINLINE void pop_cas_failure() noexcept { increment(POP_CAS_FAILURES); }
+    ATOMIC_QUEUE_SINLINE void push_spin() noexcept { increment(PUSH_SPINS); }
+    ATOMIC_QUEUE_SINLINE void pop_spin() noexcept { increment(POP_SPINS); }
+    ATOMIC_QUEUE_SINLINE void try_push_failure() noexcept { increment(TRY_PUSH_FAILURES); }
+    ATOMIC_QUEUE_SINLINE void try_pop_failure() noexcept { increment(TRY_POP_FAILURES); }
+
+    ATOMIC_QUEUE_SINLINE void size(unsigned n) noexcept {
+        auto& max_size = local().max_size;
+        if(ATOMIC_QUEUE_UNLIKELY(as_signed(n) > as_signed(max_size.load(X)))) // tail_ may be ahead of head_ with pop.
+            max_size.store(n, X);
+    }
+
+    // Sums up the counters of all threads. May be called from any thread at any time.
+    static StatsSnapshot snapshot() {
+        Counters sum;
+        Registry& r = registry();
+        {
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.exited.add_to(sum);
+            for(Counters* c : r.threads)
+                c->add_to(sum);
+        }
+        auto get = [&sum](unsigned i) { return sum.counters[i].load(X); };
+        return {get(PUSH_CAS_FAILURES), get(POP_CAS_FAILURES), get(PUSH_SPINS), get(POP_SPINS), get(TRY_PUSH_FAILURES), get(TRY_POP_FAILURES),
+                sum.max_size.load(X)};
+    }
+
+    // Zeroes the counters of all threads. Not thread-safe: no thread may be using the queues with this Stats type concurrently.
+    static void reset() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.exited.clear();
+        for(Counters* c : r.threads)
+            c->clear();
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace atomic_queue
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // ATOMIC_QUEUE_STATS_H_INCLUDED
@@ -0,0 +1,20 @@
+#!/usr/bin/env python
+
+# Copyright (c) 2019 Maxim Egorushkin. MIT License. See the full licence in file LICENSE.
+
+import sys
+import pandas as pd
+import json
+from collections import defaultdict
+
+from parse_output import *
+
+results = list(parse_output(sys.stdin))
+df = as_capacity_df(results)
+
+output = defaultdict(list) # name,threads: capacity, min, max, mean, stdev
+for (name, threads, capacity), data in df.groupby(['queue', 'threads', 'capacity']):
+    s = data["msg/sec"].describe(percentiles=None)
+    output[f"{name},{int(threads)}"].append([int(capacity), *[int(s[f]) for f in ['min', 'max', 'mean', 'std']]])
+output['host'] = hosts(results)
+json.dump(output, sys.stdout)
@@ -0,0 +1,181 @@
+#!/usr/bin/env python
+
+# Copyright (c) 2019 Maxim Egorushkin. MIT License. See the full licence in file LICENSE.
+
+# Compares two sets of benchmark results, e.g. before and after a library upgrade:
+#
+#   scripts/compare.py -b results/1a3774a.ryzen_5950x.* -c results/<commit>.ryzen_5950x.*
+#
+# Reads both the text output of the benchmarks (*.txt, one sample per line per repetition) and the JSON Lines files written
+# when AQJ is set (*.jsonl, one sample per run). For each queue, number of threads and placement present in both sets, reports
+# the change of the median, its bootstrap confidence interval and the Mann-Whitney U test p-value. Exits with status 1 when any
+# change is a significant regression beyond the threshold, so that it can gate library upgrades.
+
+import sys
+import re
+import math
+import random
+import argparse
+from collections import defaultdict
+
+from parse_output import parse_output, msg_per_sec
+
+# The units of the results and whether higher is better.
+HIGHER_IS_BETTER = {'msg/sec': True, 'sec/round-trip': False, 'cycles/op': False}
+
+_line_parser = re.compile(r"\s*(.+):\s+([,.0-9]+)\s+(\S+)")
+
+def key_of(name, unit):
+    """(queue, threads, unit), where threads is '<threads>,<placement>' or '<producers>x<consumers>,<placement>'."""
+    parts = name.rsplit(',', 2)
+    if len(parts) == 3:
+        return parts[0].strip(), "{},{}".format(parts[1].strip(), parts[2].strip()), unit
+    return name.strip(), '', unit
+
+
+def parse_text(f, samples):
+    for line in f:
+        m = _line_parser.match(line)
+        if m:
+            unit = m.group(3).rstrip(',')
+            if unit in HIGHER_IS_BETTER:
+                samples[key_of(m.group(1), unit)].append(float(m.group(2).replace(',', '')))
+
+
+def parse_json(f, samples):
+    for host, r in parse_output(f):
+        if r['benchmark'] == 'throughput':
+            threads = "{},{}".format(r['producers'], r['placement'])
+        elif r['benchmark'] == 'grid':
+            threads = "{}x{},{}".format(r['producers'], r['consumers'], r['placement'])
+        elif r['benchmark'] == 'work':
+            threads = "{},{}ns".format(r['producers'], r['work_ns'])
+        elif r['benchmark'] in ('ping-pong', 'matrix') and 'cpus' in r:
+            # The queue names of the template parameter matrix, e.g. OptimistAtomicQueue/mpmc/mc, are distinct from the others.
+            samples[(r['queue'], "cpus {}".format('-'.join(map(str, r['cpus']))), 'sec/round-trip')] += \
+                [2 * cycles / host['tsc_hz'] / r['messages'] for cycles in r['cycles']]
+            continue
+        elif r['benchmark'] == 'matrix':
+            threads = "{},{}".format(r['producers'], r['placement'])
+        else:
+            continue
+        samples[(r['queue'], threads, 'msg/sec')] += msg_per_sec(host, r)
+
+
+def load(filenames):
+    samples = defaultdict(list)
+    for filename in filenames:
+        with open(filename) as f:
+            (parse_json if filename.endswith('.jsonl') else parse_text)(f, samples)
+    return samples
+
+
+def median(x):
+    s = sorted(x)
+    n = len(s)
+    return s[n // 2] if n % 2 else (s[n // 2 - 1] + s[n // 2]) * .5
+
+
+def bootstrap_ci(a, b, confidence, n_resamples, rng):
+    """The confidence interval of median(b) / median(a) - 1."""
+    ratios = sorted(median(rng.choices(b, k=len(b))) / median(rng.choices(a, k=len(a))) - 1 for _ in range(n_resamples))
+    tail = (1 - confidence) / 2
+    return ratios[int(tail * (n_resamples - 1))], ratios[int(math.ceil((1 - tail) * (n_resamples - 1)))]
+
+
+def _u_distribution(n1, n2):
+    """The number of arrangements of two samples of sizes n1 and n2 for each value of the U statistic."""
+    f = [[1] for _ in range(n2 + 1)] # n1 = 0: U is 0.
+    for i in range(1, n1 + 1):
+        g = [[1]] # n2 = 0: U is 0.
+        for j in range(1, n2 + 1):
+            # The largest element is either from the first sample, adding j to U, or from the second one.
+            counts = [0] * (i * j + 1)
+            for u, c in enumerate(f[j]):
+                counts[u + j] += c
+            for u, c in enumerate(g[j - 1]):
+                counts[u] += c
+            g.append(counts)
+        f = g
+    return f[n2]
+
+
+def mann_whitney_p(a, b):
+    """The two-sided p-value of the Mann-Whitney U test. Exact for small samples without ties, the normal approximation
+    with the tie correction otherwise."""
+    n1, n2 = len(a), len(b)
+    pooled = sorted([(x, 0) for x in a] + [(x, 1) for x in b])
+    ranks = [0.] * len(pooled)
+    ties = 0
+    i = 0
+    while i < len(pooled):
+        j = i
+        while j + 1 < len(pooled) and pooled[j + 1][0] == pooled[i][0]:
+            j += 1
+        for k in range(i, j + 1):
+            ranks[k] = (i + j) * .5 + 1
+        t = j - i + 1
+        ties += t ** 3 - t
+        i = j + 1
+    u1 = sum(r for r, (x, sample) in zip(ranks, pooled) if sample == 0) - n1 * (n1 + 1) * .5
+    u = min(u1, n1 * n2 - u1)
+
+    if not ties and n1 * n2 <= 400:
+        counts = _u_distribution(n1, n2)
+        return min(1., 2 * sum(counts[:int(u) + 1]) / sum(counts))
+
+    n = n1 + n2
+    sigma = math.sqrt(n1 * n2 / 12. * ((n + 1) - ties / (n * (n - 1.))))
+    if not sigma:
+        return 1.
+    z = (n1 * n2 * .5 - u - .5) / sigma # With the continuity correction.
+    return min(1., math.erfc(max(z, 0) / math.sqrt(2)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compares benchmark results and fails on significant regressions.")
+    parser.add_argument('-b', '--baseline', nargs='+', required=True, help="The baseline results files.")
+    parser.add_argument('-c', '--candidate', nargs='+', required=True, help="The candidate results files.")
+    parser.add_argument('-t', '--threshold', type=float, default=3, help="The regression threshold, %% of the baseline median (default 3).")
+    parser.add_argument('-a', '--alpha', type=float, default=.05, help="The significance level (default 0.05).")
+    parser.add_argument('-n', '--resamples', type=int, default=2000, help="The bootstrap resamples (default 2000).")
+    parser.add_argument('-q', '--queue', help="Only the queues matching this regular expression.")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    candidate = load(args.candidate)
+    queue_filter = re.compile(args.queue) if args.queue else None
+    rng = random.Random(0) # Reproducible confidence intervals.
+    confidence = 1 - args.alpha
+
+    print("{:>40s} {:>14s} {:>14s} {:>5s} {:>16s} {:>16s} {:>8s} {:>18s} {:>8s}".format(
+          "queue", "threads", "unit", "runs", "baseline", "candidate", "change", "{:.0%} CI".format(confidence), "p-value"))
+    regressions = 0
+    for key in sorted(baseline.keys() & candidate.keys()):
+        queue, threads, unit = key
+        if queue_filter and not queue_filter.search(queue):
+            continue
+        a, b = baseline[key], candidate[key]
+        sign = 1 if HIGHER_IS_BETTER[unit] else -1
+        change = median(b) / median(a) - 1
+        lo, hi = bootstrap_ci(a, b, confidence, args.resamples, rng)
+        p = mann_whitney_p(a, b)
+        verdict = ''
+        if p < args.alpha:
+            verdict = 'better' if change * sign > 0 else 'worse'
+            if change * sign * 100 < -args.threshold:
+                verdict = 'REGRESSION'
+                regressions += 1
+        print("{:>40s} {:>14s} {:>14s} {:>2d}/{:<2d} {:16.9g} {:16.9g} {:+7.1%} [{:+7.1%},{:+7.1%}] {:8.4f} {}".format(
+              queue, threads, unit, len(a), len(b), median(a), median(b), change, lo, hi, p, verdict))
+
+    only = len(baseline.keys() ^ candidate.keys())
+    if only:
+        print("{} results are present in one set only and not compared.".format(only), file=sys.stderr)
+    if regressions:
+        print("{} significant regressions beyond {}%.".format(regressions, args.threshold), file=sys.stderr)
+    return 1 if regressions else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,19 @@
+#!/usr/bin/env python
+
+# Copyright (c) 2019 Maxim Egorushkin. MIT License. See the full licence in file LICENSE.
+
+import sys
+import pandas as pd
+import json
+from collections import defaultdict
+
+from parse_output import *
+
+results = list(parse_output(sys.stdin))
+df = as_grid_df(results)
+
+output = defaultdict(list) # name: producers, consumers, min, max, mean, stdev
+for (name, producers, consumers), data in df.groupby(['queue', 'producers', 'consumers']):
+    s = data["msg/sec"].describe(percentiles=None)
+    output[name].append([int(producers), int(consumers), *[int(s[f]) for f in ['min', 'max', 'mean', 'std']]])
+json.dump(output, sys.stdout)
@@ -0,0 +1,27 @@
+#!/usr/bin/env python
+
+# Copyright (c) 2019 Maxim Egorushkin. MIT License. See the full licence in file LICENSE.
+
+# The history of 1 producer and 1 consumer throughput and of ping-pong latency of one machine over commits, from many results
+# files, e.g. scripts/history_to_json.py results/*.ryzen_5950x.smt1.*.jsonl. The commits are in the order of the time of their
+# first benchmark run.
+
+import sys
+import pandas as pd
+import json
+
+from parse_output import *
+
+results = []
+for filename in sys.argv[1:]:
+    with open(filename) as f:
+        results += parse_output(f)
+df = as_history_df(results)
+
+commits = df.groupby('commit')['time'].min().sort_values()
+output = {'commits': [[commit, time] for commit, time in commits.items()]} # unit: {name: [mean or null for each commit]}
+for (unit, name), data in df.groupby(['unit', 'queue']):
+    means = data.groupby('commit')['value'].mean()
+    output.setdefault(unit, {})[name] = [int(means[c]) if c in means else None for c in commits.index]
+output['host'] = hosts(results)
+json.dump(output, sys.stdout)
@@ -14,4 +14,5 @@ output = dict() # name: min, max, mean, stdev
 for name, data in df.groupby('queue'):
     s = data["sec/round-trip"].describe()
     output[name] = [int(s[f] * 1e9) for f in ['min', 'max', 'mean', 'std']]
+output['host'] = hosts(results)
 json.dump(output, sys.stdout)
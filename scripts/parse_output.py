@@ -2,29 +2,145 @@
 
 # Copyright (c) 2019 Maxim Egorushkin. MIT License. See the full licence in file LICENSE.
 
+# Parses the JSON Lines files written by the benchmarks when environment variable AQJ is set, *.jsonl, and the text output of
+# the benchmarks, *.txt, such as the results committed in results/. Each JSON line is one benchmarks invocation with its host
+# description and the cycles of every run. The text output has the best run of each benchmark only and no host description.
+
 import re
+import json
+import itertools
 import pandas as pd
 
-_parser = re.compile("\s*(.+):\s+([,.0-9]+)\s+(\S+)")
+def parse_json(f):
+    for line in f:
+        if line.strip():
+            report = json.loads(line)
+            host = report['host']
+            for result in report['results']:
+                yield host, result
+
 
-def parse_output(f):
+_line_parser = re.compile(r"\s*(.+):\s+([,.0-9]+)\s+(\S+)")
+
+def parse_text(f):
+    """The throughput and ping-pong lines of the text output as parse_json results, with the printed value in place of the
+    cycles of the runs and an empty host description. The template parameter matrix results, with names such as
+    OptimistAtomicQueue/mpmc/mc, are benchmark 'matrix', as in the JSON output."""
+    host = {}
     for line in f:
-        m = _parser.match(line)
-        if m:
-            queue = m.group(1)
-            units = m.group(3)
-            value = float(m.group(2).replace(',', ''))
-            yield queue, units, value
+        m = _line_parser.match(line)
+        if not m:
+            continue
+        name, value, unit = m.group(1), float(m.group(2).replace(',', '')), m.group(3).rstrip(',')
+        if unit == 'sec/round-trip':
+            queue = name.strip()
+            yield host, {'benchmark': 'matrix' if '/' in queue else 'ping-pong', 'queue': queue, unit: value}
+        elif unit == 'msg/sec':
+            queue, threads, placement = (s.strip() for s in name.rsplit(',', 2))
+            if placement.endswith('ns'): # The work benchmark, threads,<work>ns.
+                continue
+            producers, _, consumers = threads.partition('x')
+            benchmark = 'matrix' if '/' in queue else 'grid' if consumers else 'throughput'
+            yield host, {'benchmark': benchmark, 'queue': queue, 'producers': int(producers),
+                         'consumers': int(consumers or producers), 'placement': placement, unit: value}
+
+
+def parse_output(f):
+    """Parses a file by its suffix. Without one, e.g. stdin, the first non-blank line tells JSON Lines from the text output."""
+    name = getattr(f, 'name', '')
+    if name.endswith('.jsonl'):
+        return parse_json(f)
+    if name.endswith('.txt'):
+        return parse_text(f)
+    lines = iter(f)
+    head = []
+    for line in lines:
+        head.append(line)
+        if line.strip():
+            break
+    return (parse_json if head and head[-1].startswith('{') else parse_text)(itertools.chain(head, lines))
+
 
+def msg_per_sec(host, result):
+    if 'cycles' not in result: # Text output.
+        return [result['msg/sec']]
+    return [result['messages'] * host['tsc_hz'] / cycles for cycles in result['cycles']]
 
-def extract_name_threads(name_theads):
-    name, threads, si = name_theads.split(',')
-    return name, int(threads)
+
+def sec_per_round_trip(host, result):
+    if 'cycles' not in result: # Text output.
+        return [result['sec/round-trip']]
+    return [2 * cycles / host['tsc_hz'] / result['messages'] for cycles in result['cycles']]
 
 
 def as_scalability_df(results):
-    return pd.DataFrame.from_records(((*extract_name_threads(r[0]), r[2]) for r in results if r[1] == 'msg/sec'), columns=['queue', 'threads', 'msg/sec'])
+    # Less the oversubscribed runs, placements 'p' and 'u', with more threads than CPUs.
+    return pd.DataFrame.from_records(((r['queue'], r['producers'], v) for h, r in results if r['benchmark'] == 'throughput' and r['placement'] not in 'pu' for v in msg_per_sec(h, r)),
+                                     columns=['queue', 'threads', 'msg/sec'])
+
+
+def as_grid_df(results):
+    return pd.DataFrame.from_records(((r['queue'], r['producers'], r['consumers'], v) for h, r in results if r['benchmark'] == 'grid' for v in msg_per_sec(h, r)),
+                                     columns=['queue', 'producers', 'consumers', 'msg/sec'])
+
+
+_capacity_parser = re.compile("(.+)<([0-9]+)>$")
+_payload_parser = re.compile("(.+)<([0-9]+)B>$")
+
+def extract_name_capacity(name):
+    m = _capacity_parser.match(name)
+    return (m.group(1), int(m.group(2))) if m else (name, None)
+
+
+def as_capacity_df(results):
+    df = as_scalability_df(results)
+    df[['queue', 'capacity']] = [extract_name_capacity(name) for name in df['queue']]
+    return df[df['capacity'].notna()]
+
+
+def extract_name_payload(name):
+    m = _payload_parser.match(name)
+    return (m.group(1), int(m.group(2))) if m else (name, None)
+
+
+def as_payload_df(results):
+    df = as_scalability_df(results)
+    df[['queue', 'payload']] = [extract_name_payload(name) for name in df['queue']]
+    return df[df['payload'].notna()]
 
 
 def as_latency_df(results):
-    return pd.DataFrame.from_records(((r[0], r[2]) for r in results if r[1] == 'sec/round-trip'), columns=['queue', 'sec/round-trip'])
+    return pd.DataFrame.from_records(((r['queue'], v) for h, r in results if r['benchmark'] == 'ping-pong' for v in sec_per_round_trip(h, r)),
+                                     columns=['queue', 'sec/round-trip'])
+
+
+def as_percentiles_df(results):
+    return pd.DataFrame.from_records(((r['queue'], r['producers'], r['placement'], p, cycles * 1e9 / h['tsc_hz'])
+                                      for h, r in results if r['benchmark'] == 'latency' for p, cycles in r['percentiles'].items()),
+                                     columns=['queue', 'threads', 'placement', 'percentile', 'ns'])
+
+
+def as_history_df(results):
+    """1 producer and 1 consumer throughput and ping-pong latency by commit, in the order of the benchmark run times. Less the
+    text output results, which have no commit."""
+    def records():
+        for h, r in results:
+            if 'git_hash' not in h:
+                continue
+            commit = (h.get('time', ''), h['git_hash'])
+            if r['benchmark'] == 'throughput' and r['producers'] == 1 and r['placement'] == 's':
+                yield from ((*commit, r['queue'], 'msg/sec', v) for v in msg_per_sec(h, r))
+            elif r['benchmark'] == 'ping-pong':
+                yield from ((*commit, r['queue'], 'ns/round-trip', v * 1e9) for v in sec_per_round_trip(h, r))
+    return pd.DataFrame.from_records(records(), columns=['time', 'commit', 'queue', 'unit', 'value'])
+
+
+def hosts(results):
+    """The distinct host descriptions, less the CPU topology and the run time, for the dashboard."""
+    unique = {}
+    for h, r in results:
+        if not h: # Text output.
+            continue
+        host = {k: v for k, v in h.items() if k not in ('topology', 'hw_thread_ids', 'time')}
+        unique[json.dumps(host, sort_keys=True)] = host
+    return list(unique.values())
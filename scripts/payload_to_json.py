@@ -0,0 +1,20 @@
+#!/usr/bin/env python
+
+# Copyright (c) 2019 Maxim Egorushkin. MIT License. See the full licence in file LICENSE.
+
+import sys
+import pandas as pd
+import json
+from collections import defaultdict
+
+from parse_output import *
+
+results = list(parse_output(sys.stdin))
+df = as_payload_df(results)
+
+output = defaultdict(list) # name,threads: payload bytes, min, max, mean, stdev
+for (name, threads, payload), data in df.groupby(['queue', 'threads', 'payload']):
+    s = data["msg/sec"].describe(percentiles=None)
+    output[f"{name},{int(threads)}"].append([int(payload), *[int(s[f]) for f in ['min', 'max', 'mean', 'std']]])
+output['host'] = hosts(results)
+json.dump(output, sys.stdout)
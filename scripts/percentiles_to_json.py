@@ -0,0 +1,24 @@
+#!/usr/bin/env python
+
+# Copyright (c) 2019 Maxim Egorushkin. MIT License. See the full licence in file LICENSE.
+
+# The latency percentiles of 1 producer and 1 consumer, the median of all benchmark invocations, from the latency benchmark
+# results, AQB option 1024.
+
+import sys
+import pandas as pd
+import json
+
+from parse_output import *
+
+results = list(parse_output(sys.stdin))
+df = as_percentiles_df(results)
+df = df[(df['threads'] == 1) & (df['placement'] == 's')]
+
+order = {p: i for i, p in enumerate(['p50', 'p90', 'p99', 'p99.9', 'p99.99', 'max'])}
+output = dict() # name: [percentile, nanoseconds]...
+for name, data in df.groupby('queue'):
+    medians = data.groupby('percentile')['ns'].median()
+    output[name] = sorted(([p, int(ns)] for p, ns in medians.items()), key=lambda a: order[a[0]])
+output['host'] = hosts(results)
+json.dump(output, sys.stdout)
@@ -21,7 +21,7 @@ function benchmark() {
         ((remaining <= 0)) && break
         ((++i))
         $lb echo "[$i] $((remaining / 60))m:$((remaining % 60))s to go..."
-        sudo chrt -f 50 "$exe"
+        sudo chrt -f 50 env AQJ=results-${cpucount}.${now}.jsonl "$exe"
     done
 }
 
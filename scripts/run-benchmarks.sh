@@ -13,7 +13,7 @@ function benchmark() {
     let N=${N:-33}
     for((i=1;i<=N;++i)); do
         $lb echo -n "[$i/$N] "
-        sudo chrt -f 50 "$exe"
+        sudo chrt -f 50 env AQJ=results-${cpucount}.${now}.jsonl "$exe"
     done
 }
 
@@ -17,4 +17,5 @@ for (name, threads), data in df.groupby(['queue', 'threads']):
     s = data["msg/sec"].describe(percentiles=None)
     threads = int(threads)
     output[name].append([threads, *[int(s[f]) for f in ['min', 'max', 'mean', 'std']]])
+output['host'] = hosts(results)
 json.dump(output, sys.stdout)
@@ -17,7 +17,7 @@ r = re.compile("\s*(.+):\s+([,.0-9]+)\s+(\S+)")
 for line in sys.stdin:
     m = r.match(line)
     if m:
-        results[m.group(1)][m.group(3)].append(float(m.group(2).replace(',', '')))
+        results[m.group(1)][m.group(3).rstrip(",")].append(float(m.group(2).replace(',', '')))
 
 def format_msg_sec(d, media, benchmark):
     return "{:11,.0f} {} (median: {:11,.0f}, mean: {:11,.0f} stdev: {:11,.0f})".format(d.minmax[1], benchmark, median, d.mean, math.sqrt(d.variance))
@@ -43,6 +43,112 @@ function disassemble-symbol {(
 )}
 
 
+# Extract the innermost hot loop of each matching symbol and run it through llvm-mca for each of the MCA_CPUS models.
+# The loop is the widest backward conditional branch whose body has no pause or call, i.e. the uncontended fast path.
+# x86-64 only. Prints a table of instructions, uops, cycles per iteration, block reciprocal throughput and top port pressure.
+function mca-symbol {(
+    set -eu
+    shopt -s extglob
+
+    local re_symbol="$1" obj="$2"
+
+    local out="$(/bin/realpath -s "$2")" address type cxx_symbol cxx_symbol2 mcpu
+    local out_prefix="$(dirname "$out")"
+    local -A folded
+    local mcpus=(${MCA_CPUS:-haswell skylake icelake-server znver3})
+    local llvm_mca=(${LLVM_MCA:-llvm-mca} -iterations=${MCA_ITERATIONS:-1000})
+
+    local extract_loop='
+        function hex(s,  i, n) { n = 0; s = tolower(s); for(i = 1; i <= length(s); ++i) n = n * 16 + index("0123456789abcdef", substr(s, i, 1)) - 1; return n }
+        /^ *[0-9a-f]+:\t/ {
+            a = $0; sub(/:.*/, "", a); gsub(/ /, "", a);
+            t = $0; sub(/^[^\t]*\t/, "", t); sub(/ *(<|#).*$/, "", t);
+            split(t, f, /[ \t]+/);
+            ++n; label[n] = a; addr[n] = hex(a); insn[n] = t; mnem[n] = f[1]; target[n] = -1;
+            if(f[1] ~ /^j/ && f[2] ~ /^[0-9a-f]+$/) target[n] = hex(f[2]);
+        }
+        END {
+            for(i = 1; i <= n; ++i) {
+                if(mnem[i] == "jmp" || target[i] < 0 || target[i] > addr[i])
+                    continue;
+                for(s = i; s > 0 && addr[s] > target[i]; --s);
+                if(s < 1 || addr[s] != target[i])
+                    continue;
+                clean = 1;
+                for(k = s; k <= i; ++k)
+                    if(mnem[k] ~ /^(pause|call)/)
+                        clean = 0;
+                span = addr[i] - addr[s];
+                if(clean > best_clean || (clean == best_clean && span > best_span)) {
+                    best_clean = clean; best_span = span; b = s; e = i;
+                }
+            }
+            if(!e)
+                exit 1;
+            for(k = b; k <= e; ++k)
+                if(target[k] >= addr[b] && target[k] <= addr[e])
+                    is_label[target[k]] = 1;
+            print ".intel_syntax noprefix";
+            for(k = b; k <= e; ++k) {
+                if(addr[k] in is_label)
+                    print ".L" label[k] ":";
+                if(mnem[k] ~ /^(nop|xchg ax,ax|data16|cs)/)
+                    continue;
+                if(target[k] >= 0)
+                    insn[k] = mnem[k] " " (target[k] in is_label ? sprintf(".L%x", target[k]) : ".Lexit");
+                print insn[k];
+            }
+            print ".Lexit:";
+        }'
+
+    local summarize='
+        /^Iterations:/ { iterations = $2 }
+        /^Instructions:/ { instructions = $2 }
+        /^Total Cycles:/ { cycles = $3 }
+        /^Total uOps:/ { uops = $3 }
+        /^Block RThroughput:/ { rthroughput = $3 }
+        /^\[[0-9.]+\] +- / { unit = $1; gsub(/^\[[0-9]+|\]$/, "", unit); resource[$1] = $3 unit }
+        /^Resource pressure per iteration:/ {
+            getline; m = split($0, h);
+            getline; split($0, v);
+            for(i = 1; i <= m; ++i)
+                if(v[i] != "-")
+                    print v[i], resource[h[i]] | "sort -rn | head -3 > " tmp;
+            close("sort -rn | head -3 > " tmp);
+        }
+        END {
+            pressure = "";
+            while((getline line < tmp) > 0) {
+                split(line, p);
+                pressure = pressure (pressure ? " " : "") p[2] "=" p[1];
+            }
+            printf "  %-16s %6.0f %6.2f %11.2f %11s  %s\n", mcpu, instructions / iterations, uops / iterations, cycles / iterations, rthroughput, pressure;
+        }'
+
+    local tmp="$(mktemp)"
+    trap "rm -f '$tmp'" EXIT
+
+    printf "  %-16s %6s %6s %11s %11s  %s\n" mcpu insns uops cycles/iter rthroughput "port pressure/iter"
+    nm -C --defined-only "$obj" | egrep -e "$re_symbol" | while read address type cxx_symbol; do
+        cxx-symbol-to-filename "$cxx_symbol" cxx_symbol2
+        out="${out_prefix}/${cxx_symbol2}.mca.s"
+        echo "$out: ${cxx_symbol}"
+        if [[ -v folded[$address] ]]; then # Identical code folding aliases, which objdump doesn't disassemble.
+            echo "  same code as ${folded[$address]}"
+            continue
+        fi
+        folded[$address]="$cxx_symbol"
+        if ! ( (( ${V:-0} < 1 )) || set -x; objdump --no-show-raw-insn -Mintel -C --disassemble="$cxx_symbol" "$obj" ) | awk "$extract_loop" > "$out"; then
+            echo "  no loop found"
+            continue
+        fi
+        for mcpu in "${mcpus[@]}"; do
+            "${llvm_mca[@]}" -mcpu="$mcpu" "$out" | awk -v mcpu="$mcpu" -v tmp="$tmp" "$summarize"
+        done
+    done
+)}
+
+
 function create_system_config_mk {(
     set -eu
     cat <<EOF
@@ -100,10 +206,23 @@ function format_benchmark {(
         # local commit=${BASH_REMATCH[1]}
         local cpu_name=${BASH_REMATCH[2]}
         local -i smt=${BASH_REMATCH[3]}
-        for m in scalability latency; do
+        for m in scalability latency percentiles capacity payload; do
             printf "// %s\n%s_%s_%s: " "$r" ${prefix[$smt]} $m $cpu_name
             scripts/${m}_to_json.py < "$r"
             printf ",\n\n"
         done
     done
 )}
+
+# The results of all commits of one machine, oldest first, for the history charts in html/.
+# cd ~/src/atomic_queue; source ./scripts/util.sh; format_history results/*.ryzen_5950x.smt1.*.jsonl
+function format_history {(
+    set -eu
+    local prefix=(cc smt)
+    [[ "$1" =~ results/([^.]+)\.([^.]+)\.smt([01])\. ]] || raise "$1"
+    local cpu_name=${BASH_REMATCH[2]}
+    local -i smt=${BASH_REMATCH[3]}
+    printf "// %s\n%s_history_%s: " "$*" ${prefix[$smt]} $cpu_name
+    scripts/history_to_json.py "$@"
+    printf ",\n\n"
+)}
@@ -5,6 +5,8 @@
 #include "atomic_queue/atomic_queue.h"
 #include "atomic_queue/atomic_queue_mutex.h"
 #include "atomic_queue/barrier.h"
+#include "atomic_queue/latest_value.h"
+#include "atomic_queue/overwrite_queue.h"
 
 #include <xenium/michael_scott_queue.hpp>
 #include <xenium/ramalhete_queue.hpp>
@@ -19,21 +21,43 @@
 
 #include "cpu_base_frequency.h"
 #include "huge_pages.h"
+#include "json_writer.h"
+#include "latency_histogram.h"
 #include "moodycamel.h"
+#include "perf_counters.h"
 #include "benchmarks.h"
 
 
 #include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
 #include <clocale>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iterator>
 #include <limits>
+#include <memory>
+#include <optional>
+#include <random>
+#include <regex>
 #include <stdexcept>
+#include <string>
+#include <system_error>
 #include <thread>
 #include <type_traits>
+#include <typeinfo>
 #include <vector>
 
+#include <cxxabi.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 using std::uint64_t;
@@ -52,26 +76,111 @@ namespace {
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 int constexpr N_MSG = 1'000'000;
-int constexpr RUNS = 3;
+int constexpr RUNS = 3; // The default number of runs of each measurement.
+int constexpr MAX_RUNS = 30; // The default maximum number of runs with a confidence interval target.
+
+// The AQB bits which skip built-in queues, see QueueEntry.
+enum QueueOptions : unsigned long long {
+    MINIMAL      = 1, // Only the reference and the queues of this library.
+    NO_VARIANT_A = 8,
+    NO_VARIANT_B = 16,
+    NO_VARIANT_1 = 32,
+    NO_VARIANT_2 = 64
+};
+
+// The benchmarks which run a queue in addition to the throughput, latency, open-loop and ping-pong ones, see QueueEntry.
+enum QueueSuites : unsigned {
+    GRID           = 1,
+    SUSTAINED      = 2,
+    OVERSUBSCRIBED = 4,
+    WORK           = 8,
+    ALL_SUITES     = GRID | SUSTAINED | OVERSUBSCRIBED | WORK
+};
 
 struct Options : EnvBits64 {
-    ATOMIC_QUEUE_INLINE constexpr auto       minimal() const noexcept { return value & 1; };
+    ATOMIC_QUEUE_INLINE constexpr auto       minimal() const noexcept { return value & MINIMAL; };
 
     ATOMIC_QUEUE_INLINE constexpr auto  no_ping_pong() const noexcept { return value & 2; };
     ATOMIC_QUEUE_INLINE constexpr auto no_throughput() const noexcept { return value & 4; };
 
-    ATOMIC_QUEUE_INLINE constexpr auto  no_variant_a() const noexcept { return value & 8; };
-    ATOMIC_QUEUE_INLINE constexpr auto  no_variant_b() const noexcept { return value & 16; };
-    ATOMIC_QUEUE_INLINE constexpr auto  no_variant_1() const noexcept { return value & 32; };
-    ATOMIC_QUEUE_INLINE constexpr auto  no_variant_2() const noexcept { return value & 64; };
+    ATOMIC_QUEUE_INLINE constexpr auto  no_variant_a() const noexcept { return value & NO_VARIANT_A; };
+    ATOMIC_QUEUE_INLINE constexpr auto  no_variant_b() const noexcept { return value & NO_VARIANT_B; };
+    ATOMIC_QUEUE_INLINE constexpr auto  no_variant_1() const noexcept { return value & NO_VARIANT_1; };
+    ATOMIC_QUEUE_INLINE constexpr auto  no_variant_2() const noexcept { return value & NO_VARIANT_2; };
 
     ATOMIC_QUEUE_INLINE constexpr auto       no_spsc() const noexcept { return value & 128; };
+
+    // Opt-in benchmarks.
+    ATOMIC_QUEUE_INLINE constexpr auto     overwrite() const noexcept { return value & 256; };
+    ATOMIC_QUEUE_INLINE constexpr auto  latest_value() const noexcept { return value & 512; };
+    ATOMIC_QUEUE_INLINE constexpr auto       latency() const noexcept { return value & 1024; };
+    ATOMIC_QUEUE_INLINE constexpr auto     open_loop() const noexcept { return value & 2048; };
+    ATOMIC_QUEUE_INLINE constexpr auto       payload() const noexcept { return value & 4096; };
+    ATOMIC_QUEUE_INLINE constexpr auto      capacity() const noexcept { return value & 8192; };
+    ATOMIC_QUEUE_INLINE constexpr auto          grid() const noexcept { return value & 16384; };
+    ATOMIC_QUEUE_INLINE constexpr auto     sustained() const noexcept { return value & 32768; };
+    ATOMIC_QUEUE_INLINE constexpr auto latency_matrix() const noexcept { return value & 65536; };
+    ATOMIC_QUEUE_INLINE constexpr auto  single_thread() const noexcept { return value & 131072; };
+    ATOMIC_QUEUE_INLINE constexpr auto oversubscribed() const noexcept { return value & 262144; };
+    ATOMIC_QUEUE_INLINE constexpr auto           work() const noexcept { return value & 524288; };
+    ATOMIC_QUEUE_INLINE constexpr auto         matrix() const noexcept { return value & 1048576; };
+    ATOMIC_QUEUE_INLINE constexpr auto         window() const noexcept { return value & 2097152; };
+};
+
+// The message send schedules of open-loop producers.
+enum class Arrivals { CONSTANT, POISSON, BURSTY };
+char const* const ARRIVALS_NAMES[] = {"constant", "Poisson", "bursty"};
+
+struct OpenLoop {
+    Arrivals arrivals;
+    double interval; // The mean number of cycles between the messages of one producer.
+};
+
+class Report;
+
+// Selects the benchmarks of queues by "<benchmark>/<queue>" names, e.g. "ping-pong/AtomicQueue" or "grid/AtomicQueueB".
+struct Selection {
+    std::vector<std::regex> include; // Any of these must match, when not empty.
+    std::vector<std::regex> exclude; // None of these may match.
+    bool list = false;               // Print the names of the selected benchmarks instead of running them.
+
+    bool selected(std::string const& name) const {
+        auto const matches = [&name](std::regex const& re) { return std::regex_search(name, re); };
+        return (include.empty() || std::any_of(include.begin(), include.end(), matches)) &&
+            std::none_of(exclude.begin(), exclude.end(), matches);
+    }
+};
+
+// How run_throughput_benchmarks measures the queues.
+enum class Mode {
+    THROUGHPUT, // Closed-loop producers, best of runs msg/sec.
+    LATENCY,    // Closed-loop producers, enqueue-to-dequeue latency percentiles.
+    OPEN_LOOP   // Rate-controlled producers, latency percentiles versus offered load.
 };
 
 struct Params {
     Options options{"AQB"};
     int n_msg = EnvBits64{"AQN", N_MSG, 1, INT_MAX}.value;
+    unsigned long long open_loop_rate = EnvBits64{"AQR"}.value; // The total offered msg/sec of open-loop producers, 0 to sweep.
+    Arrivals arrivals = static_cast<Arrivals>(EnvBits64{"AQA", 0, 0, 2}.value);
     std::vector<unsigned> hw_thread_ids;
+    std::vector<unsigned> llc_hw_thread_ids; // Consecutive pairs share the last-level cache, for placement 'l'.
+    std::string placements = "si"; // The thread placements of the throughput benchmarks, see time_throughput_once.
+    Mode mode = Mode::THROUGHPUT;
+    unsigned capacity = 0; // The capacity of CapacityContextAdaptor queues.
+    Report* report = nullptr; // Collects the results of every run for JSON output, when AQJ is set.
+    bool perf_counters = EnvBits64{"AQP", 0, 0, 1}.value; // Count the hardware events of the benchmark threads.
+
+    // The command line options, see usage.
+    char const* benchmark = "throughput"; // The running benchmark, which prefixes the queue names matched by the selection.
+    Selection const* selection = nullptr;
+    int threads_min = 1;                  // The range of the numbers of producers and consumers.
+    int threads_max = INT_MAX;
+    unsigned runs = RUNS;                 // The minimum number of runs of each measurement.
+    unsigned warmup_runs = 0;             // Discarded runs before the measured ones.
+    double ci = 0;                        // Run until the 95% confidence interval of the mean is within this fraction of the mean.
+    unsigned max_runs = MAX_RUNS;         // The maximum number of runs with a ci.
+    bool fork = true;                     // Run each selected benchmark of one queue in a child process.
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -89,6 +198,39 @@ using isum_t = long long;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// A trivially copyable payload of market data message sizes.
+template<unsigned WORDS>
+struct Payload {
+    uint64_t words[WORDS];
+};
+
+// Converts message numbers and time stamps into queue elements and back.
+template<class T>
+struct Message {
+    ATOMIC_QUEUE_SINLINE T make(unsigned n) noexcept { return n; }
+    ATOMIC_QUEUE_SINLINE unsigned value(T m) noexcept { return m; }
+};
+
+template<unsigned WORDS>
+struct Message<Payload<WORDS>> {
+    ATOMIC_QUEUE_SINLINE Payload<WORDS> make(unsigned n) noexcept {
+        Payload<WORDS> m;
+        for(auto& word : m.words)
+            word = n;
+        return m;
+    }
+
+    // Read the entire payload, as real consumers do.
+    ATOMIC_QUEUE_SINLINE unsigned value(Payload<WORDS> const& m) noexcept {
+        uint64_t sum = 0;
+        for(auto word : m.words)
+            sum += word;
+        return sum / WORDS;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 template<class P>
 struct Range {
     P p, q;
@@ -122,6 +264,420 @@ ATOMIC_QUEUE_INLINE double to_seconds(icycles_t cycles) noexcept {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+using Grid = std::vector<std::pair<unsigned, unsigned>>; // The numbers of producers and consumers.
+struct WorkSize;
+
+// A queue of the throughput, latency, open-loop and ping-pong benchmarks and of its suites, see RegisterQueue.
+struct QueueEntry {
+    char const* name;
+    unsigned capabilities;         // QueueCapabilities.
+    unsigned long long skipped_by; // QueueOptions, any of which in AQB skips the queue.
+    unsigned suites;               // QueueSuites.
+    void(*throughput)(char const* name, Params const* params);
+    void(*ping_pong)(char const* name, Params const* params);
+    void(*grid)(char const* name, Params const* params, Grid const& grid);
+    void(*sustained)(char const* name, Params const* params, cycles_t duration, cycles_t interval);
+    void(*oversubscribed)(char const* name, Params const* params, unsigned n_threads);
+    void(*work)(char const* name, Params const* params, std::vector<WorkSize> const& work_sizes);
+};
+
+using QueueRegistry = Registry<QueueEntry>;
+
+// The suites of a queue, less the ones its capabilities don't support: grid_producer stop messages require one FIFO order of all
+// producers, oversubscribed and work require MPMC.
+unsigned supported_suites(QueueEntry const& queue) noexcept {
+    unsigned suites = queue.suites;
+    if(queue.capabilities & SPSC_ONLY)
+        suites &= SUSTAINED;
+    if(queue.capabilities & PER_PRODUCER_FIFO)
+        suites &= ~GRID;
+    return suites;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ATOMIC_QUEUE_GIT_HASH
+#define ATOMIC_QUEUE_GIT_HASH "" // Defined by the build.
+#endif
+
+#ifdef __clang__
+char constexpr COMPILER[] = "clang-" __clang_version__;
+#else
+char constexpr COMPILER[] = "gcc-" __VERSION__;
+#endif
+
+template<class T>
+std::string type_name() {
+    int status;
+    std::unique_ptr<char, void(*)(void*)> name{abi::__cxa_demangle(typeid(T).name(), nullptr, nullptr, &status), std::free};
+    return status ? typeid(T).name() : name.get();
+}
+
+// The latency percentiles of latency benchmarks.
+struct LatencyPercentile {
+    char const* name;
+    double p;
+};
+LatencyPercentile constexpr LATENCY_PERCENTILES[] = {{"p50", .5}, {"p90", .9}, {"p99", .99}, {"p99.9", .999}, {"p99.99", .9999}};
+
+// The measurements of one queue in one benchmark configuration.
+struct Result {
+    char const* benchmark;           // "throughput", "latency", "open-loop", "grid", "sustained", "work", "ping-pong", "latency-matrix",
+                                     // "overwrite", "window" or "matrix", whose ping-pong results have cpus.
+    std::string queue;               // The printed name.
+    unsigned producers;
+    unsigned consumers;
+    char placement;                  // 's', 'i', 'l', 'p' or 'u' for the throughput benchmarks, see time_throughput_once.
+    unsigned capacity;               // The run-time capacity, 0 when it is a template argument.
+    unsigned long long messages;     // Of each run.
+    std::vector<cycles_t> cycles;    // The total time of each run.
+    std::vector<unsigned> cpus = {}; // The hw_thread_ids of ping-pong threads.
+    std::vector<unsigned long long> samples = {}; // The messages of each sampling interval of sustained runs, cycles are the intervals.
+    unsigned work_ns = 0;            // The synthetic work per message of work benchmarks.
+    std::vector<unsigned> percentiles = {}; // The latencies in cycles at LATENCY_PERCENTILES and the maximum, of latency benchmarks.
+    unsigned window = 0;             // The messages in flight of windowed ping-pong benchmarks.
+    unsigned long long offered = 0;  // The total offered msg/sec of open-loop benchmarks.
+};
+
+// Collects the raw results of every run, which are appended to file AQJ as one line of JSON per benchmarks invocation, along
+// with the host description. The printed results are the summaries of these.
+//
+// The results are stored as JSON, so that a benchmark run in a child process passes its results to the parent as a string.
+class Report {
+    std::string results_; // JSON objects separated by commas.
+
+public:
+    template<class Queue>
+    void add(Result const& r) {
+        JsonWriter j(results_);
+        if(!results_.empty())
+            results_ += ',';
+        j.begin_object();
+        j.member("benchmark", r.benchmark).member("queue", r.queue).member("type", type_name<Queue>());
+        if(r.placement) {
+            j.member("producers", r.producers).member("consumers", r.consumers);
+            char const placement[2] = {r.placement, 0};
+            j.member("placement", placement);
+        }
+        if(r.capacity)
+            j.member("capacity", r.capacity);
+        if(r.work_ns)
+            j.member("work_ns", r.work_ns);
+        if(r.window)
+            j.member("window", r.window);
+        if(r.offered)
+            j.member("offered", r.offered);
+        if(!r.cpus.empty()) {
+            j.key("cpus").begin_array();
+            for(unsigned cpu : r.cpus)
+                j.value(cpu);
+            j.end_array();
+        }
+        j.member("messages", r.messages);
+        j.key("cycles").begin_array();
+        for(cycles_t c : r.cycles)
+            j.value(static_cast<unsigned long long>(c));
+        j.end_array();
+        if(!r.samples.empty()) {
+            j.key("samples").begin_array();
+            for(unsigned long long n : r.samples)
+                j.value(n);
+            j.end_array();
+        }
+        if(!r.percentiles.empty()) {
+            j.key("percentiles").begin_object();
+            for(size_t i = 0; i < std::size(LATENCY_PERCENTILES); ++i)
+                j.member(LATENCY_PERCENTILES[i].name, r.percentiles[i]);
+            j.member("max", r.percentiles.back());
+            j.end_object();
+        }
+        j.end_object();
+    }
+
+    std::string const& results() const noexcept {
+        return results_;
+    }
+
+    // Adds the results of another report.
+    void merge(std::string const& results) {
+        if(!results_.empty() && !results.empty())
+            results_ += ',';
+        results_ += results;
+    }
+
+    std::string to_json(Params const& params, TscFrequency const& tsc) const {
+        std::string s;
+        JsonWriter j(s);
+        j.begin_object();
+
+        j.key("host").begin_object();
+        j.member("cpu_model", cpu_model_name());
+        j.member("tsc_hz", static_cast<unsigned long long>(tsc.ghz * 1e9 + .5));
+        j.member("tsc_source", tsc.source);
+        j.member("compiler", COMPILER);
+        j.member("git_hash", ATOMIC_QUEUE_GIT_HASH);
+        char time[32];
+        std::time_t const now = std::time(nullptr);
+        std::tm utc;
+        std::strftime(time, sizeof time, "%Y-%m-%dT%H:%M:%SZ", ::gmtime_r(&now, &utc));
+        j.member("time", time); // For the history of results of different commits.
+        j.key("topology").begin_array();
+        for(auto& cpu : get_cpu_topology_info()) {
+            j.begin_object();
+            j.member("socket_id", cpu.socket_id).member("core_id", cpu.core_id).member("hw_thread_id", cpu.hw_thread_id);
+            j.member("l2_id", cpu.l2_id).member("llc_id", cpu.llc_id).member("node_id", cpu.node_id);
+            j.end_object();
+        }
+        j.end_array();
+        j.key("hw_thread_ids").begin_array();
+        for(unsigned cpu : params.hw_thread_ids)
+            j.value(cpu);
+        j.end_array();
+        j.end_object();
+
+        j.member("options", params.options.value);
+        j.member("runs", params.runs).member("warmup_runs", params.warmup_runs);
+        j.key("results").begin_array();
+        s += results_;
+        j.end_array();
+
+        j.end_object();
+        s += '\n';
+        return s;
+    }
+
+    void write(std::FILE* f, char const* filename, Params const& params, TscFrequency const& tsc) const {
+        if(std::fputs(to_json(params, tsc).c_str(), f) < 0 || std::fflush(f))
+            throw std::system_error(errno, std::system_category(), filename);
+    }
+
+    void write(char const* filename, Params const& params, TscFrequency const& tsc) const {
+        std::unique_ptr<std::FILE, int(*)(std::FILE*)> f{std::fopen(filename, "a"), std::fclose};
+        if(!f)
+            throw std::system_error(errno, std::system_category(), filename);
+        write(f.get(), filename, params, tsc);
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t huge_pages_size(Options options) noexcept {
+    size_t constexpr MB = 1024 * 1024;
+    return (options.capacity() ? 128 : 32) * MB; // 16M-element queues require 80MB.
+}
+
+unsigned n_failed_benchmarks = 0; // The child processes which failed.
+
+// Runs f(params) in a child process when params->fork, so that heap fragmentation, huge pages and CPU frequency of one benchmark
+// don't carry over into the next one. The child allocates its own huge pages, because the huge pages of the parent would be
+// copied on write, and passes its results to the parent report through a pipe.
+template<class F>
+void run_isolated(char const* name, Params const* params, F&& f) {
+    if(!params->fork)
+        return f(params);
+
+    int fds[2];
+    if(::pipe(fds))
+        throw std::system_error(errno, std::system_category(), "pipe");
+    std::fflush(stdout); // Or the child would print the buffered output again.
+    std::fflush(stderr);
+    pid_t const pid = ::fork();
+    if(pid < 0)
+        throw std::system_error(errno, std::system_category(), "fork");
+
+    if(!pid) { // The child.
+        ::close(fds[0]);
+        int status = EXIT_SUCCESS;
+        try {
+            HugePages hp(HugePages::PAGE_1GB, huge_pages_size(params->options));
+            HugePages::instance = &hp;
+            Report report;
+            Params child = *params;
+            child.report = params->report ? &report : nullptr;
+            f(static_cast<Params const*>(&child));
+            for(char const *p = report.results().data(), *end = p + report.results().size(); p != end;) {
+                ssize_t const n = ::write(fds[1], p, end - p);
+                if(n < 0)
+                    throw std::system_error(errno, std::system_category(), "write");
+                p += n;
+            }
+        }
+        catch(std::exception const& e) {
+            fprintf(stderr, "%s/%s: %s\n", params->benchmark, name, e.what());
+            status = EXIT_FAILURE;
+        }
+        std::fflush(stdout);
+        std::fflush(stderr);
+        std::_Exit(status); // Don't destroy the objects of the parent.
+    }
+
+    ::close(fds[1]);
+    std::string results;
+    char buf[4096];
+    for(ssize_t n; (n = ::read(fds[0], buf, sizeof buf));) {
+        if(n > 0)
+            results.append(buf, n);
+        else if(errno != EINTR)
+            throw std::system_error(errno, std::system_category(), "read");
+    }
+    ::close(fds[0]);
+
+    int status;
+    while(::waitpid(pid, &status, 0) < 0)
+        if(errno != EINTR)
+            throw std::system_error(errno, std::system_category(), "waitpid");
+    if(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS) {
+        if(params->report)
+            params->report->merge(results);
+    }
+    else {
+        if(WIFSIGNALED(status))
+            fprintf(stderr, "%s/%s: the benchmark process was killed by signal %d.\n", params->benchmark, name, WTERMSIG(status));
+        ++n_failed_benchmarks;
+    }
+}
+
+// Whether the benchmark of one queue is selected by name. When listing the benchmarks, prints the name and returns false.
+bool selected(char const* name, Params const* params) {
+    Selection const* selection = params->selection;
+    if(!selection)
+        return true;
+    std::string const benchmark_name = std::string(params->benchmark) + '/' + name;
+    if(!selection->selected(benchmark_name))
+        return false;
+    if(selection->list) {
+        std::puts(benchmark_name.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Runs the benchmark of one queue, if it is selected by name.
+template<class F>
+void run_selected(char const* name, Params const* params, F&& f) {
+    if(selected(name, params))
+        run_isolated(name, params, std::forward<F>(f));
+}
+
+// Whether a number of producers or consumers is in the range selected on the command line.
+ATOMIC_QUEUE_INLINE bool in_thread_range(Params const* params, int n_threads) noexcept {
+    return n_threads >= params->threads_min && n_threads <= params->threads_max;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Runs whose median absolute deviation exceeds this fraction of the median are unstable.
+double constexpr UNSTABLE_MAD = .05;
+
+// The two-sided 95% quantiles of Student's t-distribution with 1 to 30 degrees of freedom, the normal distribution beyond.
+double constexpr T_95[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228, 2.201, 2.179, 2.160, 2.145, 2.131,
+                           2.120, 2.110, 2.101, 2.093, 2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+
+// Finite, unlike infinity(), which is undefined with -ffinite-math-only. Compare RunStats::n instead of doing arithmetic on it.
+double constexpr NO_CI = std::numeric_limits<double>::max();
+
+// The statistics of the times of the runs of one measurement.
+struct RunStats {
+    unsigned n;
+    cycles_t min;
+    double median;
+    double mad;      // The median absolute deviation.
+    double ci;       // The half-width of the 95% confidence interval of the mean relative to the mean, NO_CI for fewer than 2 runs.
+    bool unstable;   // The runs vary too much.
+};
+
+double median(std::vector<double> v) noexcept {
+    size_t const n = v.size();
+    std::nth_element(v.begin(), v.begin() + n / 2, v.end());
+    double const upper = v[n / 2];
+    return n % 2 ? upper : (*std::max_element(v.begin(), v.begin() + n / 2) + upper) / 2;
+}
+
+// Counts the runs of one measurement: params->warmup_runs discarded runs first, then at least params->runs measured runs. With
+// params->ci, the runs continue up to params->max_runs, until the confidence interval of the mean is narrow enough:
+//
+//     for(Runs runs(params); runs.more(); HugePages::instance->check_huge_pages_leaks(name)) {
+//         cycles_t const n_cycles = ...;
+//         if(!runs.add(n_cycles))
+//             continue; // A warm-up run.
+//         ...
+//     }
+class Runs {
+    Params const* params_;
+    unsigned warmup_runs_;
+    std::vector<cycles_t> cycles_;
+
+public:
+    explicit Runs(Params const* params) noexcept
+        : params_(params)
+        , warmup_runs_(params->warmup_runs)
+    {}
+
+    // Whether to run once more.
+    bool more() const {
+        unsigned const n = cycles_.size();
+        if(warmup_runs_ || n < params_->runs)
+            return true;
+        return params_->ci && n < params_->max_runs && (n < 2 || stats().ci > params_->ci);
+    }
+
+    // Whether the next run is a warm-up run.
+    bool warmup() const noexcept {
+        return warmup_runs_;
+    }
+
+    // Records the time of a run. Returns false for a warm-up run.
+    bool add(cycles_t n_cycles) {
+        if(warmup_runs_) {
+            --warmup_runs_;
+            return false;
+        }
+        cycles_.push_back(n_cycles);
+        return true;
+    }
+
+    std::vector<cycles_t> const& cycles() const noexcept {
+        return cycles_;
+    }
+
+    RunStats stats() const {
+        unsigned const n = cycles_.size();
+        if(ATOMIC_QUEUE_UNLIKELY(!n))
+            return {0, CYCLES_MAX, 0, 0, NO_CI, true}; // No measured runs yet, e.g. only the warm-up runs.
+
+        std::vector<double> v(cycles_.begin(), cycles_.end());
+        RunStats s{n, *std::min_element(cycles_.begin(), cycles_.end()), median(v), 0, NO_CI, false};
+
+        double mean = 0;
+        for(double& x : v) {
+            mean += x;
+            x = std::abs(x - s.median);
+        }
+        mean /= n;
+        s.mad = median(v);
+
+        if(n > 1) {
+            double sum_squares = 0;
+            for(cycles_t c : cycles_)
+                sum_squares += (c - mean) * (c - mean);
+            double const t = n - 1 <= std::size(T_95) ? T_95[n - 2] : 1.96;
+            s.ci = t * std::sqrt(sum_squares / (n - 1) / n) / mean;
+        }
+        s.unstable = s.mad > s.median * UNSTABLE_MAD || (params_->ci && (n < 2 || s.ci > params_->ci));
+        return s;
+    }
+};
+
+// Prints the variation of the runs after the best result.
+void print_variation(RunStats const& s) {
+    if(ATOMIC_QUEUE_UNLIKELY(!s.n))
+        printf(", no runs");
+    else
+        printf(", MAD %.1f%%, %u runs%s", s.mad / s.median * 100, s.n, s.unstable ? ", unstable" : "");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 template<class Queue>
 struct BoostSpScAdapter : Queue {
     using T = typename Queue::value_type;
@@ -197,25 +753,41 @@ using BoostAllocator = boost::lockfree::allocator<Allocator>;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// Build with -DATOMIC_QUEUE_BENCHMARK_STATS=1 to count and print the hot-path statistics of atomic_queue queues.
+// The statistics counting slows down the queues, it is disabled by default.
+#ifndef ATOMIC_QUEUE_BENCHMARK_STATS
+#define ATOMIC_QUEUE_BENCHMARK_STATS 0
+#endif
+using BenchmarkStats = std::conditional_t<ATOMIC_QUEUE_BENCHMARK_STATS, Stats<>, NoStats>;
+
+// The queues for atomic elements, which are not available for other element types T.
+template<unsigned C, bool SPSC, bool MINIMIZE_CONTENTION, bool MAXIMIZE_THROUGHPUT, class T, bool = std::is_scalar<T>::value>
+struct AtomicQueueTypes {};
+
+template<unsigned C, bool SPSC, bool MINIMIZE_CONTENTION, bool MAXIMIZE_THROUGHPUT, class T>
+struct AtomicQueueTypes<C, SPSC, MINIMIZE_CONTENTION, MAXIMIZE_THROUGHPUT, T, true> {
+    using Allocator = HugePageAllocator<T>;
+
+    using AtomicQueue =                            RetryDecorator<A::AtomicQueue<T, C, T{}, MINIMIZE_CONTENTION, MAXIMIZE_THROUGHPUT, false, SPSC, BenchmarkStats>>;
+    using OptimistAtomicQueue =                                   A::AtomicQueue<T, C, T{}, MINIMIZE_CONTENTION, MAXIMIZE_THROUGHPUT, false, SPSC, BenchmarkStats>;
+    using AtomicQueueB =        RetryDecorator<CapacityArgAdaptor<A::AtomicQueueB<T, Allocator, T{}, MAXIMIZE_THROUGHPUT, false, SPSC, BenchmarkStats>, C>>;
+    using OptimistAtomicQueueB =               CapacityArgAdaptor<A::AtomicQueueB<T, Allocator, T{}, MAXIMIZE_THROUGHPUT, false, SPSC, BenchmarkStats>, C>;
+};
+
 // According to my benchmarking, it looks like the best performance is achieved with the following parameters:
 // * For SPSC: SPSC=true,  MINIMIZE_CONTENTION=false, MAXIMIZE_THROUGHPUT=false.
 // * For MPMC: SPSC=false, MINIMIZE_CONTENTION=true,  MAXIMIZE_THROUGHPUT=true.
 // However, I am not sure that conflating these 3 parameters into 1 would be the right thing for every scenario.
-template<unsigned C, bool SPSC, bool MINIMIZE_CONTENTION, bool MAXIMIZE_THROUGHPUT>
-struct QueueTypes {
-    using T = unsigned;
-
-    // For atomic elements only.
-    using AtomicQueue =                            RetryDecorator<A::AtomicQueue<T, C, T{}, MINIMIZE_CONTENTION, MAXIMIZE_THROUGHPUT, false, SPSC>>;
-    using OptimistAtomicQueue =                                   A::AtomicQueue<T, C, T{}, MINIMIZE_CONTENTION, MAXIMIZE_THROUGHPUT, false, SPSC>;
-    using AtomicQueueB =        RetryDecorator<CapacityArgAdaptor<A::AtomicQueueB<T, Allocator, T{}, MAXIMIZE_THROUGHPUT, false, SPSC>, C>>;
-    using OptimistAtomicQueueB =               CapacityArgAdaptor<A::AtomicQueueB<T, Allocator, T{}, MAXIMIZE_THROUGHPUT, false, SPSC>, C>;
+// The template parameter matrix benchmarks rank all combinations, see run_matrix_benchmarks.
+template<unsigned C, bool SPSC, bool MINIMIZE_CONTENTION, bool MAXIMIZE_THROUGHPUT, class T = unsigned>
+struct QueueTypes : AtomicQueueTypes<C, SPSC, MINIMIZE_CONTENTION, MAXIMIZE_THROUGHPUT, T> {
+    using Allocator = HugePageAllocator<T>;
 
     // For non-atomic elements.
-    using AtomicQueue2 =                     RetryDecorator<A::AtomicQueue2<T, C, MINIMIZE_CONTENTION, MAXIMIZE_THROUGHPUT, false, SPSC>>;
-    using OptimistAtomicQueue2 =                            A::AtomicQueue2<T, C, MINIMIZE_CONTENTION, MAXIMIZE_THROUGHPUT, false, SPSC>;
-    using AtomicQueueB2 = RetryDecorator<CapacityArgAdaptor<A::AtomicQueueB2<T, Allocator, MAXIMIZE_THROUGHPUT, false, SPSC>, C>>;
-    using OptimistAtomicQueueB2 =        CapacityArgAdaptor<A::AtomicQueueB2<T, Allocator, MAXIMIZE_THROUGHPUT, false, SPSC>, C>;
+    using AtomicQueue2 =                     RetryDecorator<A::AtomicQueue2<T, C, MINIMIZE_CONTENTION, MAXIMIZE_THROUGHPUT, false, SPSC, BenchmarkStats>>;
+    using OptimistAtomicQueue2 =                            A::AtomicQueue2<T, C, MINIMIZE_CONTENTION, MAXIMIZE_THROUGHPUT, false, SPSC, BenchmarkStats>;
+    using AtomicQueueB2 = RetryDecorator<CapacityArgAdaptor<A::AtomicQueueB2<T, Allocator, MAXIMIZE_THROUGHPUT, false, SPSC, BenchmarkStats>, C>>;
+    using OptimistAtomicQueueB2 =        CapacityArgAdaptor<A::AtomicQueueB2<T, Allocator, MAXIMIZE_THROUGHPUT, false, SPSC, BenchmarkStats>, C>;
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -238,50 +810,120 @@ struct ThreadState {
     alignas(CACHE_LINE_SIZE)
     Times times;
     std::atomic<sum_t> sum = {};
+    std::uint64_t counters[PerfCounters::N_EVENTS] = {};
 
     std::thread thread;
 };
 using ThreadStates = std::vector<ThreadState, HugePageAllocator<ThreadState>>;
 
+// The hardware performance counters summed over the threads of runs.
+struct PerfTotals {
+    std::uint64_t counters[PerfCounters::N_EVENTS] = {};
+
+    template<class Threads>
+    void add(Threads const& threads) noexcept {
+        for(auto& thr : threads)
+            for(unsigned i = 0; i < PerfCounters::N_EVENTS; ++i)
+                counters[i] += thr.counters[i];
+    }
+
+    // The events of all threads per message, so that a message costs the cycles of both its producer and consumer.
+    void print(char const* name, unsigned runs, double n_msg) const {
+        printf("%32s  perf per message of %u runs:", name, runs);
+        char sep = ' ';
+        for(unsigned i = 0; i < PerfCounters::N_EVENTS; ++i) {
+            if(PerfCounters::supported(i)) {
+                printf("%c%s %'.3f", sep, PerfCounters::event_names[i], counters[i] / n_msg);
+                sep = ',';
+            }
+        }
+        printf("\n");
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The synthetic work per message of work benchmarks, in iterations of do_work.
+struct Work {
+    unsigned producer;
+    unsigned consumer;
+};
+
+// A chain of dependent multiply-adds, which the compiler can neither elide nor vectorize, so that the cycles per iteration are
+// constant and don't depend on the memory accesses of the queue.
+ATOMIC_QUEUE_INLINE unsigned do_work(unsigned x, unsigned iterations) noexcept {
+    for(unsigned i = iterations; i--;) {
+        x = x * 1664525u + 1013904223u;
+        asm volatile("" : "+r"(x));
+    }
+    return x;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 struct SharedState {
     // These remain constant.
     alignas(CACHE_LINE_SIZE)
     unsigned const n_producer_msg;
+    unsigned const n_consumers;
     unsigned n_threads = 0;
 
     void* queue0 = 0;
     void* queue1 = 0;
 
     ThreadState* const threads;
-    unsigned const* ATOMIC_QUEUE_RESTRICT hw_thread_ids;
+    unsigned const* ATOMIC_QUEUE_RESTRICT hw_thread_ids; // 0 for unpinned threads.
+    LatencyHistogram* histograms = 0; // One per thread, in latency and open-loop modes.
+    OpenLoop const* open_loop = 0;
+    std::atomic<bool> const* stop = 0; // Stops sustained mode producers.
+    Work const* work = 0;
+    unsigned window = 0; // The messages in flight of windowed ping-pong.
+    bool const perf_counters;
 
     // These are modified at the start.
-    alignas(CACHE_LINE_SIZE)
-    Barrier2 barrier;
+    TreeBarrier<> barrier;
 
-    ATOMIC_QUEUE_INLINE SharedState(Params const* params, int n_threads, ThreadState* consumer_sums) noexcept
-        : n_producer_msg((params->n_msg + (n_threads - 1)) / n_threads)
+    // These are modified at the end.
+    alignas(CACHE_LINE_SIZE) std::atomic<unsigned> producers_left;
+
+    ATOMIC_QUEUE_INLINE SharedState(Params const* params, int n_producers, int n_consumers, ThreadState* consumer_sums) noexcept
+        : n_producer_msg((params->n_msg + (n_producers - 1)) / n_producers)
+        , n_consumers(n_consumers)
         , threads(consumer_sums)
         , hw_thread_ids{params->hw_thread_ids.data()}
-        , barrier{n_threads * 2}
+        , perf_counters(params->perf_counters)
+        , barrier(n_producers + n_consumers)
+        , producers_left(n_producers)
     {
         assert(is_suitably_aligned(this));
     }
 
+    ATOMIC_QUEUE_INLINE SharedState(Params const* params, int n_threads, ThreadState* consumer_sums) noexcept
+        : SharedState(params, n_threads, n_threads, consumer_sums)
+    {}
+
     ATOMIC_QUEUE_INLINE auto as_thread_range() const noexcept {
         return as_range(threads, n_threads);
     }
 
+    ATOMIC_QUEUE_INLINE void countdown(ThreadState* thread) noexcept {
+        barrier.wait(thread - threads);
+    }
+
     ATOMIC_QUEUE_NOINLINE auto* use_this_thread() noexcept {
-        set_thread_affinity(hw_thread_ids[n_threads]); // Use this thread#0 for the first producer. Pin to the same CPU.
+        if(hw_thread_ids)
+            set_thread_affinity(hw_thread_ids[n_threads]); // Use this thread#0 for the first producer. Pin to the same CPU.
+        else
+            reset_thread_affinity(); // The threads created by this thread inherit its affinity.
         return threads + n_threads++;
     }
 
     template<class... Args>
     ATOMIC_QUEUE_NOINLINE void create_thread(Args... args) {
-        set_default_thread_affinity(hw_thread_ids[n_threads]);
+        if(hw_thread_ids)
+            set_default_thread_affinity(hw_thread_ids[n_threads]);
+        else
+            reset_default_thread_affinity();
         auto& thr = threads[n_threads];
         thr.thread = std::thread(args..., this, &thr);
         ++n_threads;
@@ -306,6 +948,18 @@ struct SharedState {
             std::abort();
         return last_end_time - first_start_time;
     }
+
+    // The spread of thread start times after the barrier release. total_time includes it.
+    ATOMIC_QUEUE_NOINLINE cycles_t start_skew() const noexcept {
+        cycles_t first_start_time = CYCLES_MAX;
+        cycles_t last_start_time = 0;
+
+        for(auto& thr : as_thread_range()) {
+            first_start_time = min_value(first_start_time, thr.times.get(0));
+            last_start_time = max_value(last_start_time, thr.times.get(0));
+        }
+        return last_start_time - first_start_time;
+    }
 };
 
 struct SharedState2 : SharedState {
@@ -334,16 +988,19 @@ ATOMIC_QUEUE_NOINLINE void throughput_producer(SharedState* ctx0, ThreadState* t
     auto* thread = thread0;
 #endif
 
+    using M = Message<ElementOf<Queue>>;
     Queue* const queue = static_cast<Queue*>(ctx->queue0);
     [[maybe_unused]] region_guard_t<Queue> guard;
     ProducerOf<Queue> producer{*queue};
     unsigned n = ctx->n_producer_msg;
+    PerfCounters perf(ctx->perf_counters);
 
-    ctx->barrier.countdown();
+    ctx->countdown(thread);
+    perf.start();
     thread->times.set(0);
 
     do {
-        producer.push(*queue, n);
+        producer.push(*queue, M::make(n));
 #if ATOMIC_QUEUE_FULL_THROTTLE
         // memory_order_release doesn't prevent reordering of _subsequent_ loads and stores prior to the memory_order_release store.
         // gcc-14 reorders decrementing n earlier. This unnecessary eager reordering butchers branch fusion for dec + jne.
@@ -353,6 +1010,8 @@ ATOMIC_QUEUE_NOINLINE void throughput_producer(SharedState* ctx0, ThreadState* t
     } while(ATOMIC_QUEUE_LIKELY(--n));
 
     thread->times.set(1);
+    perf.stop();
+    perf.read(thread->counters);
 }
 
 template<class Queue>
@@ -370,16 +1029,19 @@ ATOMIC_QUEUE_NOINLINE void throughput_consumer(SharedState* ctx0, ThreadState* t
     auto* thread = thread0;
 #endif
 
+    using M = Message<ElementOf<Queue>>;
     Queue* const queue = static_cast<Queue*>(ctx->queue0);
     [[maybe_unused]] region_guard_t<Queue> guard;
     ConsumerOf<Queue> consumer{*queue};
     unsigned n;
+    PerfCounters perf(ctx->perf_counters);
 
-    ctx->barrier.countdown();
+    ctx->countdown(thread);
+    perf.start();
     thread->times.set(0);
 
     do {
-        n = consumer.pop(*queue);
+        n = M::value(consumer.pop(*queue));
 #if ATOMIC_QUEUE_FULL_THROTTLE
         asm("":"+r"(sum));
 #endif
@@ -388,188 +1050,1152 @@ ATOMIC_QUEUE_NOINLINE void throughput_consumer(SharedState* ctx0, ThreadState* t
 
     thread->sum.store(sum, X); // Set sums are +1 biased.
     thread->times.set(1);
+    perf.stop();
+    perf.read(thread->counters);
 }
 
+// throughput_producer sends its own stop message, which requires as many consumers as producers. This producer sends
+// n_producer_msg..2 instead, and the last producer to finish sends one stop message to each consumer after all messages of
+// all producers, so that any number of producers and consumers can be paired. That requires a queue with one FIFO order of
+// all producers: in a queue which is FIFO per producer only, such as moodycamel::ConcurrentQueue, a consumer may pop a stop
+// message before the messages of other producers, which then remain in the queue.
 template<class Queue>
-ATOMIC_QUEUE_INLINE cycles_t time_throughput_once(Params const* params, int n_threads, bool alternative_placement, ThreadState* consumer_sums) {
-    auto ctx = HugePages::instance->create_unique_ptr<SharedState>(params, n_threads, consumer_sums);
-    auto queue = HugePages::instance->create_unique_ptr<Queue>(ContextOf<Queue>{n_threads, n_threads});
-    ctx->queue0 = queue.get();
-
-    auto* producer0 = ctx->use_this_thread(); // Use this thread#0 for the first producer.
+ATOMIC_QUEUE_NOINLINE void grid_producer(SharedState* ctx, ThreadState* thread) {
+    using M = Message<ElementOf<Queue>>;
+    Queue* const queue = static_cast<Queue*>(ctx->queue0);
+    [[maybe_unused]] region_guard_t<Queue> guard;
+    ProducerOf<Queue> producer{*queue};
+    unsigned n = ctx->n_producer_msg;
+    PerfCounters perf(ctx->perf_counters);
 
-    if(alternative_placement) {
-        for(int i = 0; i < n_threads; ++i) {
-            if(i) // This thread#0 is the first producer.
-                ctx->create_thread(throughput_producer<Queue>);
-            ctx->create_thread(throughput_consumer<Queue>);
-        }
-    } else {
-        for(int i = 1; i < n_threads; ++i)  // This thread#0 is the first producer.
-            ctx->create_thread(throughput_producer<Queue>);
-        for(int i = 0; i < n_threads; ++i)
-            ctx->create_thread(throughput_consumer<Queue>);
-    }
+    ctx->countdown(thread);
+    perf.start();
+    thread->times.set(0);
 
-    throughput_producer<Queue>(ctx.get(), producer0); // Use this thread#0 for the first producer.
-    ctx->join();
+    while(ATOMIC_QUEUE_LIKELY(--n))
+        producer.push(*queue, M::make(n + 1));
+    if(ctx->producers_left.fetch_sub(1, AR) == 1)
+        for(unsigned i = ctx->n_consumers; i--;)
+            producer.push(*queue, M::make(1)); // The stop messages.
 
-    return ctx->total_time();
+    thread->times.set(1);
+    perf.stop();
+    perf.read(thread->counters);
 }
 
+// throughput_producer and throughput_consumer with the synthetic work of ctx->work per message.
 template<class Queue>
-ATOMIC_QUEUE_NOINLINE void time_throughput(char const* name, Params const* params, int n_thread_min, int n_thread_max) {
-    for(auto n_threads = n_thread_min; n_threads <= n_thread_max; ++n_threads) {
-        int const n_producer_msg = (params->n_msg + (n_threads - 1)) / n_threads;
-        int const n_msg = n_producer_msg * n_threads;
-        isum_t const expected_sum = (n_producer_msg + 1) * .5 * n_producer_msg;
-        double const expected_avg_sum_inv = 1. / expected_sum;
+ATOMIC_QUEUE_NOINLINE void work_producer(SharedState* ctx, ThreadState* thread) {
+    using M = Message<ElementOf<Queue>>;
+    Queue* const queue = static_cast<Queue*>(ctx->queue0);
+    [[maybe_unused]] region_guard_t<Queue> guard;
+    ProducerOf<Queue> producer{*queue};
+    unsigned n = ctx->n_producer_msg;
+    unsigned const iterations = ctx->work->producer;
+    unsigned x = n;
 
-        for(bool alternative_placement : {false, true}) {
-            // auto const n_producer_msg = n_msg / n_threads;
-            cycles_t n_cycles_best = CYCLES_MAX;
+    ctx->countdown(thread);
+    thread->times.set(0);
 
-            for(unsigned run = RUNS; run--; HugePages::instance->check_huge_pages_leaks(name)) {
-                ThreadStates threads(n_threads * 2);
-                cycles_t n_cycles = time_throughput_once<Queue>(params, n_threads, alternative_placement, threads.data());
-                n_cycles_best = min_value(n_cycles_best, n_cycles);
-
-                // Calculate the checksum.
-                sum_t total_sum = 0;
-                unsigned consumer_idx = 0;
-                for(auto& thr : threads) {
-                    auto consumer_sum = thr.sum.load(X);
-                    // Set sums are +1 biased.
-                    if(consumer_sum--) {
-                        total_sum += consumer_sum;
-                        // Verify that no consumer was starved.
-                        auto consumer_sum_frac = as_signed(consumer_sum) * expected_avg_sum_inv;
-                        // Verify that the consumer received at least 10% of its expected average consumer sum.
-                        if(consumer_sum_frac < .1)
-                            fprintf(stderr, "%s: producers: %u: consumer %u received too few messages: %.2lf%% of expected.\n",
-                                    name, n_threads, consumer_idx, consumer_sum_frac);
-                        ++consumer_idx;
-                    }
-                }
-                // Verify that all messages were received exactly once: no duplicates, no omissions.
-                if(isum_t total_sum_diff = total_sum - expected_sum * n_threads)
-                    fprintf(stderr, "%s: wrong checksum error: producers: %u, expected_sum: %'lld, diff: %'lld.\n",
-                            name, n_threads, expected_sum * n_threads, total_sum_diff);
-            }
+    do {
+        x = do_work(x, iterations);
+        producer.push(*queue, M::make(n));
+    } while(ATOMIC_QUEUE_LIKELY(--n));
 
-            double n_seconds_best = to_seconds(n_cycles_best);
-            double msg_per_sec = n_msg / n_seconds_best;
-            printf("%32s,%2u,%c: %'11.0f msg/sec\n", name, n_threads, alternative_placement ? 'i' : 's', msg_per_sec);
-        }
-    }
+    thread->times.set(1);
 }
 
 template<class Queue>
-ATOMIC_QUEUE_INLINE void time_throughput_mpmc(char const* name, Params const* params, Type<Queue>, int n_thread_min = 1) {
-    int const n_thread_max = params->hw_thread_ids.size() / 2;
-    time_throughput<Queue>(name, params, n_thread_min, n_thread_max);
+ATOMIC_QUEUE_NOINLINE void work_consumer(SharedState* ctx, ThreadState* thread) {
+    using M = Message<ElementOf<Queue>>;
+    Queue* const queue = static_cast<Queue*>(ctx->queue0);
+    [[maybe_unused]] region_guard_t<Queue> guard;
+    ConsumerOf<Queue> consumer{*queue};
+    unsigned const iterations = ctx->work->consumer;
+    sum_t sum = 1;
+    unsigned n;
+
+    ctx->countdown(thread);
+    thread->times.set(0);
+
+    do {
+        n = M::value(consumer.pop(*queue));
+        do_work(n, iterations);
+        sum += n; // Includes stop value.
+    } while(ATOMIC_QUEUE_LIKELY(n != 1));
+
+    thread->sum.store(sum, X); // Set sums are +1 biased.
+    thread->times.set(1);
 }
 
+unsigned constexpr SUSTAINED_BATCH = 1024; // The messages between the checks of the stop flag.
+
+// Sustained mode producers run until the sampler stops them, rather than for n_producer_msg messages.
 template<class Queue>
-ATOMIC_QUEUE_INLINE void time_throughput_spsc(char const* name, Params const* params, Type<Queue>) {
-    time_throughput<Queue>(name, params, 1, 1); // 1 producer and 1 consumer only.
-}
+ATOMIC_QUEUE_NOINLINE void sustained_producer(SharedState* ctx, ThreadState* thread) {
+    using M = Message<ElementOf<Queue>>;
+    Queue* const queue = static_cast<Queue*>(ctx->queue0);
+    [[maybe_unused]] region_guard_t<Queue> guard;
+    ProducerOf<Queue> producer{*queue};
 
-ATOMIC_QUEUE_NOINLINE void run_throughput_benchmarks(Params const* params) {
-    printf("---- Running throughput benchmarks with up to %zu CPUs, %'d messages, best of %d runs (higher is better) ----\n",
-           params->hw_thread_ids.size() & -2, params->n_msg, RUNS);
+    ctx->countdown(thread);
+    thread->times.set(0);
 
-    unsigned constexpr C = 128 * 1024; // Capacity.
+    do {
+        for(unsigned n = SUSTAINED_BATCH; n; --n)
+            producer.push(*queue, M::make(2));
+    } while(ATOMIC_QUEUE_LIKELY(!ctx->stop->load(X)));
+    producer.push(*queue, M::make(1)); // The stop message.
 
-    // The reference.
-    if(ATOMIC_QUEUE_LIKELY(!params->options.no_spsc()))
-        time_throughput_spsc("boost::lockfree::spsc_queue", params,
-                             Type<BoostSpScAdapter<boost::lockfree::spsc_queue<unsigned, boost::lockfree::capacity<C>>>>{});
+    thread->times.set(1);
+}
 
-    using SPSC = QueueTypes<C, true, false, false>;
-    using MPMC = QueueTypes<C, false, true, true>; // Enable MAXIMIZE_THROUGHPUT for 2 or more producers/consumers.
+// Counts the received messages in its own ThreadState cache line, so that the sampler reading it doesn't perturb the other threads.
+template<class Queue>
+ATOMIC_QUEUE_NOINLINE void sustained_consumer(SharedState* ctx, ThreadState* thread) {
+    using M = Message<ElementOf<Queue>>;
+    Queue* const queue = static_cast<Queue*>(ctx->queue0);
+    [[maybe_unused]] region_guard_t<Queue> guard;
+    ConsumerOf<Queue> consumer{*queue};
+    sum_t n_received = 1;
 
-    if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_1())) {
-        if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_a())) {
-            if(ATOMIC_QUEUE_LIKELY(!params->options.no_spsc()))
-                time_throughput_spsc("AtomicQueue", params, Type<SPSC::AtomicQueue>{});
-            time_throughput_mpmc("AtomicQueue", params, Type<MPMC::AtomicQueue>{}, 2);
+    ctx->countdown(thread);
+    thread->times.set(0);
 
-            if(ATOMIC_QUEUE_LIKELY(!params->options.no_spsc()))
-                time_throughput_spsc("OptimistAtomicQueue", params, Type<SPSC::OptimistAtomicQueue>{});
-            time_throughput_mpmc("OptimistAtomicQueue", params, Type<MPMC::OptimistAtomicQueue>{}, 2);
-        }
+    while(ATOMIC_QUEUE_LIKELY(M::value(consumer.pop(*queue)) != 1))
+        thread->sum.store(++n_received, X); // Set sums are +1 biased.
 
-        if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_b())) {
-            if(ATOMIC_QUEUE_LIKELY(!params->options.no_spsc()))
-                time_throughput_spsc("AtomicQueueB", params, Type<SPSC::AtomicQueueB>{});
-            time_throughput_mpmc("AtomicQueueB", params, Type<MPMC::AtomicQueueB>{}, 2);
+    thread->times.set(1);
+}
 
-            if(ATOMIC_QUEUE_LIKELY(!params->options.no_spsc()))
-                time_throughput_spsc("OptimistAtomicQueueB", params, Type<SPSC::OptimistAtomicQueueB>{});
-            time_throughput_mpmc("OptimistAtomicQueueB", params, Type<MPMC::OptimistAtomicQueueB>{}, 2);
-        }
-    }
+// Latency mode messages are the lower 32 bits of the time stamp counter, with bit 1 set so that a message never equals
+// NIL 0 or the stop message 1. That introduces an error of 2 cycles at most, and limits latencies to 2^32 cycles.
+ATOMIC_QUEUE_INLINE unsigned latency_stamp(cycles_t time) noexcept {
+    return static_cast<unsigned>(time) | 2;
+}
 
-    if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_2())) {
-        if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_a())) {
-            if(ATOMIC_QUEUE_LIKELY(!params->options.no_spsc()))
-                time_throughput_spsc("AtomicQueue2", params, Type<SPSC::AtomicQueue2>{});
-            time_throughput_mpmc("AtomicQueue2", params, Type<MPMC::AtomicQueue2>{}, 2);
+template<class Queue>
+ATOMIC_QUEUE_NOINLINE void latency_producer(SharedState* ctx, ThreadState* thread) {
+    using M = Message<ElementOf<Queue>>;
+    Queue* const queue = static_cast<Queue*>(ctx->queue0);
+    [[maybe_unused]] region_guard_t<Queue> guard;
+    ProducerOf<Queue> producer{*queue};
+    unsigned n = ctx->n_producer_msg;
 
-            if(ATOMIC_QUEUE_LIKELY(!params->options.no_spsc()))
-                time_throughput_spsc("OptimistAtomicQueue2", params, Type<SPSC::OptimistAtomicQueue2>{});
-            time_throughput_mpmc("OptimistAtomicQueue2", params, Type<MPMC::OptimistAtomicQueue2>{}, 2);
-        }
+    ctx->countdown(thread);
+    thread->times.set(0);
 
-        if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_b())) {
-            if(ATOMIC_QUEUE_LIKELY(!params->options.no_spsc()))
-                time_throughput_spsc("AtomicQueueB2", params, Type<SPSC::AtomicQueueB2>{});
-            time_throughput_mpmc("AtomicQueueB2", params, Type<MPMC::AtomicQueueB2>{}, 2);
+    while(ATOMIC_QUEUE_LIKELY(--n))
+        producer.push(*queue, M::make(latency_stamp(cycles())));
+    producer.push(*queue, M::make(1)); // The stop message.
 
-            if(ATOMIC_QUEUE_LIKELY(!params->options.no_spsc()))
-                time_throughput_spsc("OptimistAtomicQueueB2", params, Type<SPSC::OptimistAtomicQueueB2>{});
-            time_throughput_mpmc("OptimistAtomicQueueB2", params, Type<MPMC::OptimistAtomicQueueB2>{}, 2);
-        }
-    }
+    thread->times.set(1);
+}
 
-    if(ATOMIC_QUEUE_LIKELY(!params->options.minimal())) {
-        time_throughput_spsc("moodycamel::ReaderWriterQueue", params, Type<MoodyCamelReaderWriterQueue<unsigned, C>>{});
-        time_throughput_mpmc("moodycamel::ConcurrentQueue", params, Type<MoodyCamelQueue<unsigned, C>>{});
-
-        time_throughput_mpmc("tbb::concurrent_bounded_queue", params, Type<TbbAdapter<tbb::concurrent_bounded_queue<unsigned>, C>>{});
-
-        time_throughput_mpmc("xenium::michael_scott_queue", params,
-            Type<XeniumQueueAdapter<xenium::michael_scott_queue<unsigned, xenium::policy::reclaimer<Reclaimer>>>>{});
-        time_throughput_mpmc("xenium::ramalhete_queue", params,
-            Type<XeniumQueueAdapter<xenium::ramalhete_queue<unsigned, xenium::policy::reclaimer<Reclaimer>>>>{});
-        time_throughput_mpmc("xenium::vyukov_bounded_queue", params,
-            Type<RetryDecorator<CapacityArgAdaptor<xenium::vyukov_bounded_queue<unsigned>, C>>>{});
-
-        unsigned constexpr BLQ_C_MAX = 0x10000 - 2;
-        unsigned constexpr BLQ_C = min_value(C, BLQ_C_MAX);
-        time_throughput_mpmc("boost::lockfree::queue", params,
-            Type<BoostQueueAdapter<boost::lockfree::queue<unsigned, BoostAllocator, boost::lockfree::capacity<BLQ_C>>>>{});
-
-        time_throughput_mpmc("pthread_spinlock", params, Type<RetryDecorator<AtomicQueueSpinlock<unsigned, C>>>{});
-        time_throughput_mpmc("std::mutex", params, Type<RetryDecorator<AtomicQueueMutex<unsigned, C, std::mutex>>>{});
-        time_throughput_mpmc("tbb::spin_mutex", params, Type<RetryDecorator<AtomicQueueMutex<unsigned, C, tbb::spin_mutex>>>{});
-        // time_throughput_mpmc("TicketSpinlock", params, Type<RetryDecorator<AtomicQueueMutex<unsigned, C, TicketSpinlock>>>{});
-        // run_throughput_mpmc_benchmark("UnfairSpinlock", params, Type<RetryDecorator<AtomicQueueMutex<unsigned, C, UnfairSpinlock>>>{});
-        // run_throughput_mpmc_benchmark<RetryDecorator<AtomicQueueSpinlockHle<unsigned, C>>>("SpinlockHle");
-        // run_throughput_mpmc_benchmark("adaptive_mutex", params, Type<RetryDecorator<AtomicQueueMutex<unsigned, C, AdaptiveMutex>>>{});
-        // run_throughput_mpmc_benchmark("tbb::speculative_spin_mutex", params,
-        //                               Type<RetryDecorator<AtomicQueueMutex<unsigned, C, tbb::speculative_spin_mutex>>>{});
-    }
+template<class Queue>
+ATOMIC_QUEUE_NOINLINE void latency_consumer(SharedState* ctx, ThreadState* thread) {
+    using M = Message<ElementOf<Queue>>;
+    Queue* const queue = static_cast<Queue*>(ctx->queue0);
+    [[maybe_unused]] region_guard_t<Queue> guard;
+    ConsumerOf<Queue> consumer{*queue};
+    LatencyHistogram& histogram = ctx->histograms[thread - ctx->threads];
+    sum_t n_received = 1;
 
-    std::puts("\n");
+    ctx->countdown(thread);
+    thread->times.set(0);
+
+    for(unsigned stamp; ATOMIC_QUEUE_LIKELY((stamp = M::value(consumer.pop(*queue))) != 1); ++n_received)
+        histogram.record(max_value(as_signed(latency_stamp(cycles()) - stamp), 0)); // Bit 1 of stamps may make a latency negative.
+
+    thread->sum.store(n_received, X); // Set sums are +1 biased.
+    thread->times.set(1);
 }
 
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The intended send times of one open-loop producer.
+class ArrivalTimes {
+    static constexpr unsigned BURST = 64; // Messages sent back-to-back in bursty schedules.
+
+    std::mt19937_64 rng_;
+    std::exponential_distribution<double> exponential_;
+    double const interval_;
+    double elapsed_ = 0; // Relative to start_ to retain the fractions of cycles.
+    cycles_t start_ = 0;
+    unsigned burst_ = 0;
+    Arrivals const arrivals_;
+
+public:
+    ArrivalTimes(OpenLoop const& open_loop, unsigned seed)
+        : rng_(seed)
+        , exponential_(1 / open_loop.interval)
+        , interval_(open_loop.interval)
+        , arrivals_(open_loop.arrivals)
+    {}
+
+    void start(cycles_t time) noexcept {
+        start_ = time;
+    }
 
-template<class Queue>
-ATOMIC_QUEUE_NOINLINE void ping_pong_receiver(SharedState* ctx0, ThreadState* thread0) {
-#if ATOMIC_QUEUE_FULL_THROTTLE
+    ATOMIC_QUEUE_INLINE cycles_t next() noexcept {
+        switch(arrivals_) {
+        case Arrivals::CONSTANT:
+            elapsed_ += interval_;
+            break;
+        case Arrivals::POISSON:
+            elapsed_ += exponential_(rng_);
+            break;
+        case Arrivals::BURSTY:
+            if(!burst_--) {
+                burst_ = BURST - 1;
+                elapsed_ += interval_ * BURST;
+            }
+            break;
+        }
+        return start_ + static_cast<cycles_t>(elapsed_);
+    }
+};
+
+template<class Queue>
+ATOMIC_QUEUE_NOINLINE void open_loop_producer(SharedState* ctx, ThreadState* thread) {
+    using M = Message<ElementOf<Queue>>;
+    Queue* const queue = static_cast<Queue*>(ctx->queue0);
+    [[maybe_unused]] region_guard_t<Queue> guard;
+    ProducerOf<Queue> producer{*queue};
+    unsigned n = ctx->n_producer_msg;
+    ArrivalTimes arrivals(*ctx->open_loop, thread - ctx->threads);
+
+    ctx->countdown(thread);
+    thread->times.set(0);
+    arrivals.start(thread->times.get(0));
+
+    while(ATOMIC_QUEUE_LIKELY(--n)) {
+        cycles_t const send_time = arrivals.next();
+        while(static_cast<icycles_t>(__rdtsc() - send_time) < 0)
+            spin_loop_pause();
+        // A producer falling behind its schedule sends immediately. Measuring latency from the intended send time, rather than
+        // from the actual one, accounts for the delay of the messages the producer couldn't send on time: no coordinated omission.
+        producer.push(*queue, M::make(latency_stamp(send_time)));
+    }
+    producer.push(*queue, M::make(1)); // The stop message.
+
+    thread->times.set(1);
+}
+
+struct RunTimes {
+    cycles_t total;
+    cycles_t start_skew;
+};
+
+using Kernel = void(SharedState*, ThreadState*);
+
+// The thread functions of a benchmark and their inputs and outputs.
+struct Kernels {
+    Kernel* producer;
+    Kernel* consumer;
+    LatencyHistogram* histograms = nullptr;
+    OpenLoop const* open_loop = nullptr;
+    std::atomic<bool> const* stop = nullptr;
+    Work const* work = nullptr;
+};
+
+// Thread placements:
+//   's' - the producers, then the consumers, on CPUs in the order of hw_thread_ids.
+//   'i' - the producers interleaved with the consumers.
+//   'l' - interleaved on CPUs ordered by the last-level cache, so that each producer and consumer pair shares one L3 cache.
+//   'p' - interleaved, with hw_thread_ids repeating CPUs to pin more than one thread to each CPU. See run_oversubscribed_benchmarks.
+//   'u' - interleaved and unpinned, the scheduler places and migrates the threads.
+template<class Queue>
+ATOMIC_QUEUE_INLINE RunTimes time_throughput_once(Params const* params, int n_producers, int n_consumers, char placement,
+                                                  ThreadState* consumer_sums,
+                                                  Kernels const& kernels = {throughput_producer<Queue>, throughput_consumer<Queue>}) {
+    auto ctx = HugePages::instance->create_unique_ptr<SharedState>(params, n_producers, n_consumers, consumer_sums);
+    auto queue = HugePages::instance->create_unique_ptr<Queue>(ContextOf<Queue>{n_producers, n_consumers, params->capacity});
+    ctx->queue0 = queue.get();
+    ctx->histograms = kernels.histograms;
+    ctx->open_loop = kernels.open_loop;
+    ctx->stop = kernels.stop;
+    ctx->work = kernels.work;
+    Kernel* const producer = kernels.producer;
+    Kernel* const consumer = kernels.consumer;
+    if(placement == 'l')
+        ctx->hw_thread_ids = params->llc_hw_thread_ids.data();
+    else if(placement == 'u')
+        ctx->hw_thread_ids = nullptr;
+
+    auto* producer0 = ctx->use_this_thread(); // Use this thread#0 for the first producer.
+
+    if(placement != 's') {
+        for(int i = 0, n = max_value(n_producers, n_consumers); i < n; ++i) {
+            if(i && i < n_producers) // This thread#0 is the first producer.
+                ctx->create_thread(producer);
+            if(i < n_consumers)
+                ctx->create_thread(consumer);
+        }
+    } else {
+        for(int i = 1; i < n_producers; ++i)  // This thread#0 is the first producer.
+            ctx->create_thread(producer);
+        for(int i = 0; i < n_consumers; ++i)
+            ctx->create_thread(consumer);
+    }
+
+    producer(ctx.get(), producer0); // Use this thread#0 for the first producer.
+    ctx->join();
+
+    return {ctx->total_time(), ctx->start_skew()};
+}
+
+// Prints the hot-path statistics accumulated since the last reset over all runs, if the queue counts them.
+template<class Queue>
+void print_stats(char const* name, unsigned runs) {
+    using S = StatsOf<Queue>;
+    if(!S::enabled)
+        return;
+    StatsSnapshot const s = S::snapshot();
+    printf("%32s  stats of %u runs: push CAS failures %'llu, pop CAS failures %'llu, push spins %'llu, pop spins %'llu, "
+           "try_push failures %'llu, try_pop failures %'llu, max size %'u\n",
+           name, runs,
+           static_cast<unsigned long long>(s.push_cas_failures), static_cast<unsigned long long>(s.pop_cas_failures),
+           static_cast<unsigned long long>(s.push_spins), static_cast<unsigned long long>(s.pop_spins),
+           static_cast<unsigned long long>(s.try_push_failures), static_cast<unsigned long long>(s.try_pop_failures),
+           s.max_size);
+}
+
+// Verifies the consumer checksums of throughput benchmarks.
+void check_sums(char const* name, int n_producers, ThreadStates const& threads, isum_t expected_sum, double expected_avg_sum_inv) {
+    sum_t total_sum = 0;
+    unsigned consumer_idx = 0;
+    for(auto& thr : threads) {
+        auto consumer_sum = thr.sum.load(X);
+        // Set sums are +1 biased.
+        if(consumer_sum--) {
+            total_sum += consumer_sum;
+            // Verify that no consumer was starved.
+            auto consumer_sum_frac = as_signed(consumer_sum) * expected_avg_sum_inv;
+            // Verify that the consumer received at least 10% of its expected average consumer sum.
+            if(consumer_sum_frac < .1)
+                fprintf(stderr, "%s: producers: %u: consumer %u received too few messages: %.2lf%% of expected.\n",
+                        name, n_producers, consumer_idx, consumer_sum_frac);
+            ++consumer_idx;
+        }
+    }
+    // Verify that all messages were received exactly once: no duplicates, no omissions.
+    if(isum_t total_sum_diff = total_sum - expected_sum)
+        fprintf(stderr, "%s: wrong checksum error: producers: %u, expected_sum: %'lld, diff: %'lld.\n",
+                name, n_producers, expected_sum, total_sum_diff);
+}
+
+template<class Queue>
+ATOMIC_QUEUE_NOINLINE void time_throughput(char const* name, Params const* params, int n_thread_min, int n_thread_max) {
+    for(auto n_threads = n_thread_min; n_threads <= n_thread_max; ++n_threads) {
+        int const n_producer_msg = (params->n_msg + (n_threads - 1)) / n_threads;
+        int const n_msg = n_producer_msg * n_threads;
+        isum_t const expected_sum = (n_producer_msg + 1) * .5 * n_producer_msg;
+        double const expected_avg_sum_inv = 1. / expected_sum;
+
+        for(char placement : params->placements) {
+            // auto const n_producer_msg = n_msg / n_threads;
+            std::vector<cycles_t> start_skews;
+            PerfTotals perf;
+            StatsOf<Queue>::reset(); // No threads are using the queues here.
+
+            Runs runs(params);
+            for(; runs.more(); HugePages::instance->check_huge_pages_leaks(name)) {
+                ThreadStates threads(n_threads * 2);
+                RunTimes const t = time_throughput_once<Queue>(params, n_threads, n_threads, placement, threads.data());
+                check_sums(name, n_threads, threads, expected_sum * n_threads, expected_avg_sum_inv);
+                if(!runs.add(t.total)) {
+                    StatsOf<Queue>::reset(); // A warm-up run.
+                    continue;
+                }
+                start_skews.push_back(t.start_skew);
+                perf.add(threads);
+            }
+
+            RunStats const stats = runs.stats();
+            double msg_per_sec = n_msg / to_seconds(stats.min);
+            printf("%32s,%2u,%c: %'11.0f msg/sec", name, n_threads, placement, msg_per_sec);
+            if(!std::is_same<ElementOf<Queue>, unsigned>::value) // Payload benchmarks.
+                printf(", %'7.3f GB/sec", msg_per_sec * sizeof(ElementOf<Queue>) * 1e-9);
+            printf(", median %'11.0f msg/sec", n_msg / to_seconds(stats.median));
+            print_variation(stats);
+            printf(" (start skew");
+            char sep = ' ';
+            for(cycles_t start_skew : start_skews) {
+                printf("%c%'llu", sep, static_cast<unsigned long long>(start_skew));
+                sep = '/';
+            }
+            printf(" cycles)\n");
+            print_stats<Queue>(name, stats.n);
+            if(params->perf_counters)
+                perf.print(name, stats.n, static_cast<double>(n_msg) * stats.n);
+
+            if(params->report)
+                params->report->add<Queue>({"throughput", name, unsigned(n_threads), unsigned(n_threads), placement,
+                                            params->capacity, unsigned(n_msg), runs.cycles()});
+        }
+    }
+}
+
+// Verifies that the latency consumers received all messages exactly once.
+void check_received(char const* name, int n_threads, ThreadStates const& threads, sum_t expected_received) {
+    sum_t received = 0;
+    for(auto& thr : threads)
+        if(auto consumer_received = thr.sum.load(X)) // Set sums are +1 biased.
+            received += consumer_received - 1;
+    if(received != expected_received * n_threads)
+        fprintf(stderr, "%s: wrong message count error: producers: %u, expected: %'llu, received: %'llu.\n",
+                name, n_threads, expected_received * n_threads, received);
+}
+
+template<class Queue>
+ATOMIC_QUEUE_NOINLINE void time_latency(char const* name, Params const* params, int n_thread_min, int n_thread_max) {
+    for(auto n_threads = n_thread_min; n_threads <= n_thread_max; ++n_threads) {
+        sum_t const expected_received = (params->n_msg + (n_threads - 1)) / n_threads - 1; // Per producer, less the stop message.
+
+        for(char placement : params->placements) {
+            auto total = std::make_unique<LatencyHistogram>(); // The latencies of all consumers in all runs.
+            Runs runs(params);
+
+            for(; runs.more(); HugePages::instance->check_huge_pages_leaks(name)) {
+                ThreadStates threads(n_threads * 2);
+                std::vector<LatencyHistogram> histograms(n_threads * 2);
+                RunTimes const t = time_throughput_once<Queue>(params, n_threads, n_threads, placement, threads.data(),
+                                                               {latency_producer<Queue>, latency_consumer<Queue>, histograms.data()});
+                check_received(name, n_threads, threads, expected_received);
+                if(!runs.add(t.total))
+                    continue; // A warm-up run.
+                for(auto& histogram : histograms)
+                    total->merge(histogram);
+            }
+
+            std::vector<unsigned> percentiles;
+            printf("%32s,%2u,%c: latency", name, n_threads, placement);
+            for(auto& p : LATENCY_PERCENTILES) {
+                percentiles.push_back(total->percentile(p.p));
+                printf(" %s %'u,", p.name, percentiles.back());
+            }
+            percentiles.push_back(total->max());
+            printf(" max %'u cycles\n", percentiles.back());
+
+            if(params->report)
+                params->report->add<Queue>({"latency", name, unsigned(n_threads), unsigned(n_threads), placement, params->capacity,
+                                            unsigned(n_threads * (expected_received + 1)), runs.cycles(), {}, {}, 0,
+                                            std::move(percentiles)});
+        }
+    }
+}
+
+// The offered loads of open-loop benchmarks relative to the closed-loop throughput.
+double constexpr OPEN_LOOP_LOADS[] = {.1, .2, .3, .4, .5, .6, .7, .8, .9, 1};
+// The knee is the highest offered load, up to which p99 latency stays within this factor of p99 latency at the lowest load,
+// and the queue sustains 95% of the offered load.
+double constexpr KNEE_LATENCY_FACTOR = 2;
+
+template<class Queue>
+ATOMIC_QUEUE_NOINLINE void time_open_loop(char const* name, Params const* params, int n_thread_min, int n_thread_max) {
+    for(auto n_threads = n_thread_min; n_threads <= n_thread_max; ++n_threads) {
+        int const n_producer_msg = (params->n_msg + (n_threads - 1)) / n_threads;
+        int const n_msg = n_producer_msg * n_threads;
+
+        for(char placement : params->placements) {
+            // The offered loads are relative to the best closed-loop throughput of the runs, unless a rate is specified.
+            double const closed_loop = params->open_loop_rate ? 0 : [&]() {
+                Runs runs(params);
+                for(; runs.more(); HugePages::instance->check_huge_pages_leaks(name)) {
+                    ThreadStates threads(n_threads * 2);
+                    runs.add(time_throughput_once<Queue>(params, n_threads, n_threads, placement, threads.data()).total);
+                }
+                return n_msg / to_seconds(runs.stats().min);
+            }();
+            std::vector<double> offered_loads;
+            if(params->open_loop_rate)
+                offered_loads.push_back(params->open_loop_rate);
+            else
+                for(double load : OPEN_LOOP_LOADS)
+                    offered_loads.push_back(load * closed_loop);
+
+            double knee = 0;
+            bool past_knee = false;
+            LatencyHistogram::value_type p99_lowest_load = 0;
+            for(double offered : offered_loads) {
+                OpenLoop const open_loop{params->arrivals, n_threads / (offered * TSC_TO_SECONDS)};
+                auto total = std::make_unique<LatencyHistogram>(); // The latencies of all consumers in all runs.
+                Runs runs(params);
+                for(; runs.more(); HugePages::instance->check_huge_pages_leaks(name)) {
+                    ThreadStates threads(n_threads * 2);
+                    std::vector<LatencyHistogram> histograms(n_threads * 2);
+                    RunTimes const t = time_throughput_once<Queue>(params, n_threads, n_threads, placement, threads.data(),
+                                                                   {open_loop_producer<Queue>, latency_consumer<Queue>, histograms.data(), &open_loop});
+                    check_received(name, n_threads, threads, n_producer_msg - 1);
+                    if(!runs.add(t.total))
+                        continue; // A warm-up run.
+                    for(auto& histogram : histograms)
+                        total->merge(histogram);
+                }
+
+                RunStats const stats = runs.stats();
+                double const achieved = n_msg / to_seconds(stats.median);
+                auto const p99 = total->percentile(.99);
+                if(!p99_lowest_load)
+                    p99_lowest_load = max_value(p99, 1u);
+                past_knee = past_knee || achieved < offered * .95 || p99 > p99_lowest_load * KNEE_LATENCY_FACTOR;
+                if(!past_knee)
+                    knee = offered;
+
+                printf("%32s,%2u,%c: offered %'11.0f, achieved %'11.0f msg/sec, latency p50 %'u, p99 %'u, p99.9 %'u, max %'u cycles",
+                       name, n_threads, placement, offered, achieved, total->percentile(.5), p99, total->percentile(.999), total->max());
+                print_variation(stats);
+                printf("\n");
+
+                if(params->report) {
+                    std::vector<unsigned> percentiles;
+                    for(auto& p : LATENCY_PERCENTILES)
+                        percentiles.push_back(total->percentile(p.p));
+                    percentiles.push_back(total->max());
+                    params->report->add<Queue>({"open-loop", name, unsigned(n_threads), unsigned(n_threads), placement, params->capacity,
+                                                unsigned(n_msg), runs.cycles(), {}, {}, 0, std::move(percentiles), 0,
+                                                static_cast<unsigned long long>(offered)});
+                }
+            }
+            if(!params->open_loop_rate)
+                printf("%32s,%2u,%c: knee at %'11.0f msg/sec, %.0f%% of closed-loop %'.0f msg/sec\n",
+                       name, n_threads, placement, knee, knee / closed_loop * 100, closed_loop);
+        }
+    }
+}
+
+// Runs the benchmark of params->mode with the numbers of threads in the range selected on the command line, if it is selected.
+template<class Queue>
+ATOMIC_QUEUE_INLINE void time_throughput_mode(char const* name, Params const* params, int n_thread_min, int n_thread_max) {
+    n_thread_min = max_value(n_thread_min, params->threads_min);
+    n_thread_max = min_value(n_thread_max, params->threads_max);
+    if(n_thread_min > n_thread_max)
+        return;
+    run_selected(name, params, [=](Params const* params) {
+        switch(params->mode) {
+        case Mode::THROUGHPUT: return time_throughput<Queue>(name, params, n_thread_min, n_thread_max);
+        case Mode::LATENCY:    return time_latency<Queue>(name, params, n_thread_min, n_thread_max);
+        case Mode::OPEN_LOOP:  return time_open_loop<Queue>(name, params, n_thread_min, n_thread_max);
+        }
+    });
+}
+
+template<class Queue>
+ATOMIC_QUEUE_INLINE void time_throughput_mpmc(char const* name, Params const* params, Type<Queue>, int n_thread_min = 1) {
+    time_throughput_mode<Queue>(name, params, n_thread_min, params->hw_thread_ids.size() / 2);
+}
+
+template<class Queue>
+ATOMIC_QUEUE_INLINE void time_throughput_spsc(char const* name, Params const* params, Type<Queue>) {
+    time_throughput_mode<Queue>(name, params, 1, 1); // 1 producer and 1 consumer only.
+}
+
+ATOMIC_QUEUE_NOINLINE void run_throughput_benchmarks(Params const* params) {
+    size_t const n_cpus = params->hw_thread_ids.size() & -2;
+    switch(params->mode) {
+    case Mode::THROUGHPUT:
+        printf("---- Running throughput benchmarks with up to %zu CPUs, %'d messages, best of %u runs (higher is better) ----\n",
+               n_cpus, params->n_msg, params->runs);
+        break;
+    case Mode::LATENCY:
+        printf("---- Running latency benchmarks with up to %zu CPUs, %'d messages, all of %u runs (lower is better) ----\n",
+               n_cpus, params->n_msg, params->runs);
+        break;
+    case Mode::OPEN_LOOP:
+        printf("---- Running open-loop benchmarks with up to %zu CPUs, %'d messages, %s arrivals (lower latency is better) ----\n",
+               n_cpus, params->n_msg, ARRIVALS_NAMES[static_cast<int>(params->arrivals)]);
+        break;
+    }
+
+    for(auto& queue : QueueRegistry::entries())
+        if(!(params->options.value & queue.skipped_by))
+            queue.throughput(queue.name, params);
+
+    std::puts("\n");
+}
+
+template<unsigned WORDS>
+ATOMIC_QUEUE_NOINLINE void run_payload_benchmarks(Params const* params, std::integer_sequence<unsigned, WORDS>) {
+    using T = Payload<WORDS>;
+    unsigned constexpr C = 16 * 1024; // Capacity. 8MB for 512-byte elements.
+    using SPSC = QueueTypes<C, true, false, false, T>;
+    using MPMC = QueueTypes<C, false, true, true, T>;
+
+    char name[64];
+    auto as_name = [&name](char const* queue) {
+        std::snprintf(name, sizeof name, "%s<%zuB>", queue, sizeof(T));
+        return name;
+    };
+
+    if(ATOMIC_QUEUE_LIKELY(!params->options.no_spsc()))
+        time_throughput_spsc(as_name("boost::lockfree::spsc_queue"), params,
+                             Type<BoostSpScAdapter<boost::lockfree::spsc_queue<T, boost::lockfree::capacity<C>>>>{});
+
+    if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_a())) {
+        if(ATOMIC_QUEUE_LIKELY(!params->options.no_spsc()))
+            time_throughput_spsc(as_name("AtomicQueue2"), params, Type<typename SPSC::AtomicQueue2>{});
+        time_throughput_mpmc(as_name("AtomicQueue2"), params, Type<typename MPMC::AtomicQueue2>{}, 2);
+
+        if(ATOMIC_QUEUE_LIKELY(!params->options.no_spsc()))
+            time_throughput_spsc(as_name("OptimistAtomicQueue2"), params, Type<typename SPSC::OptimistAtomicQueue2>{});
+        time_throughput_mpmc(as_name("OptimistAtomicQueue2"), params, Type<typename MPMC::OptimistAtomicQueue2>{}, 2);
+    }
+
+    if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_b())) {
+        if(ATOMIC_QUEUE_LIKELY(!params->options.no_spsc()))
+            time_throughput_spsc(as_name("AtomicQueueB2"), params, Type<typename SPSC::AtomicQueueB2>{});
+        time_throughput_mpmc(as_name("AtomicQueueB2"), params, Type<typename MPMC::AtomicQueueB2>{}, 2);
+
+        if(ATOMIC_QUEUE_LIKELY(!params->options.no_spsc()))
+            time_throughput_spsc(as_name("OptimistAtomicQueueB2"), params, Type<typename SPSC::OptimistAtomicQueueB2>{});
+        time_throughput_mpmc(as_name("OptimistAtomicQueueB2"), params, Type<typename MPMC::OptimistAtomicQueueB2>{}, 2);
+    }
+
+    if(ATOMIC_QUEUE_LIKELY(!params->options.minimal())) {
+        time_throughput_spsc(as_name("moodycamel::ReaderWriterQueue"), params, Type<MoodyCamelReaderWriterQueue<T, C>>{});
+        time_throughput_mpmc(as_name("moodycamel::ConcurrentQueue"), params, Type<MoodyCamelQueue<T, C>>{});
+        time_throughput_mpmc(as_name("tbb::concurrent_bounded_queue"), params, Type<TbbAdapter<tbb::concurrent_bounded_queue<T>, C>>{});
+        time_throughput_mpmc(as_name("xenium::vyukov_bounded_queue"), params,
+            Type<RetryDecorator<CapacityArgAdaptor<xenium::vyukov_bounded_queue<T>, C>>>{});
+        time_throughput_mpmc(as_name("boost::lockfree::queue"), params,
+            Type<BoostQueueAdapter<boost::lockfree::queue<T, BoostAllocator, boost::lockfree::capacity<C>>>>{});
+    }
+}
+
+template<unsigned... WORDS>
+ATOMIC_QUEUE_NOINLINE void run_payload_benchmarks(Params const* params, std::integer_sequence<unsigned, WORDS...>) {
+    printf("---- Running payload benchmarks with up to %zu CPUs, %'d messages, %zu to %zu-byte elements, best of %u runs (higher is better) ----\n",
+           params->hw_thread_ids.size() & -2, params->n_msg, std::min({WORDS...}) * sizeof(uint64_t), std::max({WORDS...}) * sizeof(uint64_t), params->runs);
+    (run_payload_benchmarks(params, std::integer_sequence<unsigned, WORDS>{}), ...);
+    std::puts("\n");
+}
+
+// Each ring buffer slot is reused at least this many times, so that the throughput is that of a cache-resident ring buffer
+// rather than of the first touch of each slot.
+unsigned constexpr CAPACITY_LAPS = 4;
+
+// AtomicQueueB/B2 always remap the indexes and round smaller capacities up to the smallest ring buffer the remap applies to.
+template<class Slot>
+unsigned constexpr MIN_REMAP_CAPACITY = 1u << (details::GetCacheLineIndexBits<CACHE_LINE_SIZE / sizeof(Slot)>::value * 2);
+
+template<unsigned LOG2_C>
+ATOMIC_QUEUE_NOINLINE void run_capacity_benchmarks(Params const* params, std::integer_sequence<unsigned, LOG2_C>) {
+    unsigned constexpr C = 1u << LOG2_C;
+    Params p = *params;
+    p.capacity = C;
+    p.n_msg = max_value(params->n_msg, static_cast<int>(C * CAPACITY_LAPS));
+
+    char name[64];
+    auto as_name = [&name](char const* queue) {
+        std::snprintf(name, sizeof name, "%s<%u>", queue, C);
+        return name;
+    };
+
+    bool const spsc = !params->options.no_spsc();
+    int const n_thread_mpmc = max_value(static_cast<int>(params->hw_thread_ids.size() / 2), 2); // The most contended only.
+
+    // Run-time capacity queues, which do not multiply the template instantiations by the number of capacities.
+    if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_b())) {
+        using Allocator = HugePageAllocator<unsigned>;
+
+        if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_1()) && C >= MIN_REMAP_CAPACITY<std::atomic<unsigned>>) {
+            if(spsc)
+                time_throughput_spsc(as_name("AtomicQueueB"), &p,
+                                     Type<RetryDecorator<CapacityContextAdaptor<A::AtomicQueueB<unsigned, Allocator, 0u, false, false, true, BenchmarkStats>>>>{});
+            time_throughput_mpmc(as_name("AtomicQueueB"), &p,
+                                 Type<RetryDecorator<CapacityContextAdaptor<A::AtomicQueueB<unsigned, Allocator, 0u, true, false, false, BenchmarkStats>>>>{},
+                                 n_thread_mpmc);
+        }
+
+        if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_2()) && C >= MIN_REMAP_CAPACITY<AtomicState>) {
+            if(spsc)
+                time_throughput_spsc(as_name("AtomicQueueB2"), &p,
+                                     Type<RetryDecorator<CapacityContextAdaptor<A::AtomicQueueB2<unsigned, Allocator, false, false, true, BenchmarkStats>>>>{});
+            time_throughput_mpmc(as_name("AtomicQueueB2"), &p,
+                                 Type<RetryDecorator<CapacityContextAdaptor<A::AtomicQueueB2<unsigned, Allocator, true, false, false, BenchmarkStats>>>>{},
+                                 n_thread_mpmc);
+        }
+    }
+
+    // The effect of the MINIMIZE_CONTENTION index remap at every other capacity, to bound the number of template instantiations.
+    // The remap is disabled for ring buffers smaller than MIN_REMAP_CAPACITY regardless of MINIMIZE_CONTENTION.
+    if constexpr(!(LOG2_C % 2)) {
+        if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_a() && !params->options.no_variant_1())) {
+            if(spsc) {
+                time_throughput_spsc(as_name("AtomicQueue-remap"), &p, Type<typename QueueTypes<C, true, true, false>::AtomicQueue>{});
+                time_throughput_spsc(as_name("AtomicQueue-linear"), &p, Type<typename QueueTypes<C, true, false, false>::AtomicQueue>{});
+            }
+            time_throughput_mpmc(as_name("AtomicQueue-remap"), &p, Type<typename QueueTypes<C, false, true, true>::AtomicQueue>{}, n_thread_mpmc);
+            time_throughput_mpmc(as_name("AtomicQueue-linear"), &p, Type<typename QueueTypes<C, false, false, true>::AtomicQueue>{}, n_thread_mpmc);
+        }
+    }
+}
+
+template<unsigned... LOG2_C>
+ATOMIC_QUEUE_NOINLINE void run_capacity_benchmarks(Params const* params, std::integer_sequence<unsigned, LOG2_C...>) {
+    printf("---- Running capacity benchmarks with %zu CPUs, at least %'d messages, %u to %u-element queues, best of %u runs (higher is better) ----\n",
+           params->hw_thread_ids.size() & -2, params->n_msg, 1u << std::min({LOG2_C...}), 1u << std::max({LOG2_C...}), params->runs);
+    (run_capacity_benchmarks(params, std::integer_sequence<unsigned, LOG2_C>{}), ...);
+    std::puts("\n");
+}
+
+// Parses a grid like "8x1,1x8,4x2" from an environment variable. Defaults to all powers of 2 which fit into n_cpus.
+Grid get_grid(char const* env_name, unsigned n_cpus) {
+    Grid grid;
+    if(char const* s = std::getenv(env_name)) {
+        for(;;) {
+            char* end;
+            unsigned long const producers = std::strtoul(s, &end, 10);
+            if(end == s || *end != 'x')
+                throw std::out_of_range(env_name);
+            s = end + 1;
+            unsigned long const consumers = std::strtoul(s, &end, 10);
+            if(end == s || !producers || !consumers || producers + consumers > n_cpus)
+                throw std::out_of_range(env_name);
+            grid.emplace_back(producers, consumers);
+            if(!*end)
+                break;
+            if(*end != ',')
+                throw std::out_of_range(env_name);
+            s = end + 1;
+        }
+    } else {
+        for(unsigned producers = 1; producers < n_cpus; producers *= 2)
+            for(unsigned consumers = 1; producers + consumers <= n_cpus; consumers *= 2)
+                grid.emplace_back(producers, consumers);
+    }
+    return grid;
+}
+
+template<class Queue>
+ATOMIC_QUEUE_NOINLINE void time_grid(char const* name, Params const* params, Grid const& grid) {
+    run_selected(name, params, [&](Params const* params) {
+        for(auto [n_producers, n_consumers] : grid) {
+            int const n_producer_msg = (params->n_msg + (n_producers - 1)) / n_producers;
+            int const n_msg = (n_producer_msg - 1) * n_producers + n_consumers;
+            // Each producer sends n_producer_msg..2, each consumer receives one stop message 1.
+            isum_t const expected_sum = ((n_producer_msg + 1) * .5 * n_producer_msg - 1) * n_producers + n_consumers;
+            double const expected_avg_sum_inv = static_cast<double>(n_consumers) / expected_sum;
+
+            for(char placement : params->placements) {
+                PerfTotals perf;
+                Runs runs(params);
+                for(; runs.more(); HugePages::instance->check_huge_pages_leaks(name)) {
+                    ThreadStates threads(n_producers + n_consumers);
+                    RunTimes const t = time_throughput_once<Queue>(params, n_producers, n_consumers, placement, threads.data(),
+                                                                   {grid_producer<Queue>, throughput_consumer<Queue>});
+                    check_sums(name, n_producers, threads, expected_sum, expected_avg_sum_inv);
+                    if(runs.add(t.total))
+                        perf.add(threads);
+                }
+                // Producers x consumers in place of the number of threads, for heatmaps.
+                RunStats const stats = runs.stats();
+                printf("%32s,%ux%u,%c: %'11.0f msg/sec, median %'11.0f msg/sec", name, n_producers, n_consumers, placement,
+                       n_msg / to_seconds(stats.min), n_msg / to_seconds(stats.median));
+                print_variation(stats);
+                printf("\n");
+                if(params->perf_counters)
+                    perf.print(name, stats.n, static_cast<double>(n_msg) * stats.n);
+
+                if(params->report)
+                    params->report->add<Queue>({"grid", name, n_producers, n_consumers, placement,
+                                                params->capacity, unsigned(n_msg), runs.cycles()});
+            }
+        }
+    });
+}
+
+ATOMIC_QUEUE_NOINLINE void run_grid_benchmarks(Params const* params) {
+    Grid grid = get_grid("AQG", params->hw_thread_ids.size());
+    grid.erase(std::remove_if(grid.begin(), grid.end(), [params](auto const& cell) {
+        return !in_thread_range(params, cell.first) || !in_thread_range(params, cell.second);
+    }), grid.end());
+    printf("---- Running producers x consumers benchmarks with %zu CPUs, %'d messages, %zu grid points, best of %u runs (higher is better) ----\n",
+           params->hw_thread_ids.size(), params->n_msg, grid.size(), params->runs);
+
+    for(auto const& queue : QueueRegistry::entries())
+        if((supported_suites(queue) & GRID) && !(params->options.value & queue.skipped_by))
+            queue.grid(queue.name, params, grid);
+
+    std::puts("\n");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Samples the messages received by the consumers of a sustained run every interval, until the duration elapses, and then stops
+// the producers. Runs in its own thread, which sleeps between the samples.
+struct Sampler {
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> stop = {false}; // Read by the producers.
+    std::vector<cycles_t> times;   // Of each sample.
+    std::vector<sum_t> received;   // The total by the time of each sample.
+
+    void run(ThreadState const* threads, size_t n_threads, cycles_t duration, cycles_t interval) {
+        // Start when all threads have passed the barrier.
+        for(auto& thr : as_range(threads, n_threads))
+            while(!thr.times.get(0))
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        for(cycles_t next = cycles(), start = next;; next += interval) {
+            cycles_t const now = cycles();
+            sum_t total = 0;
+            for(auto& thr : as_range(threads, n_threads))
+                if(sum_t consumer_received = thr.sum.load(X)) // Set sums are +1 biased.
+                    total += consumer_received - 1;
+            times.push_back(now);
+            received.push_back(total);
+            if(now - start >= duration)
+                break;
+            if(next + interval > now)
+                std::this_thread::sleep_for(std::chrono::duration<double>(to_seconds(next + interval - now)));
+        }
+        stop.store(true, X);
+    }
+};
+
+template<class Queue>
+ATOMIC_QUEUE_NOINLINE void time_sustained(char const* name, Params const* params, unsigned n_threads, cycles_t duration, cycles_t interval) {
+    if(!in_thread_range(params, n_threads))
+        return;
+    run_selected(name, params, [&](Params const* params) {
+        Sampler sampler;
+        {
+            ThreadStates threads(n_threads * 2);
+            set_default_thread_affinity(params->hw_thread_ids[0]); // Share the CPU of producer#0, which the sampler rarely wakes up on.
+            std::thread sampler_thread([&]() { sampler.run(threads.data(), threads.size(), duration, interval); });
+            time_throughput_once<Queue>(params, n_threads, n_threads, 's', threads.data(),
+                                        {sustained_producer<Queue>, sustained_consumer<Queue>, nullptr, nullptr, &sampler.stop});
+            sampler_thread.join();
+        }
+        HugePages::instance->check_huge_pages_leaks(name); // After the ThreadStates, which are HugePages memory too.
+
+        std::vector<double> rates;
+        std::vector<cycles_t> intervals;
+        std::vector<unsigned long long> samples;
+        for(size_t i = 1; i < sampler.times.size(); ++i) {
+            intervals.push_back(sampler.times[i] - sampler.times[i - 1]);
+            samples.push_back(sampler.received[i] - sampler.received[i - 1]);
+            rates.push_back(samples.back() / to_seconds(intervals.back()));
+        }
+        if(rates.empty())
+            return;
+
+        // The time series, '/'-separated like the start skews, so that it isn't parsed as a result.
+        printf("%32s,%2u,s  msg/sec every %.3f sec:", name, n_threads, to_seconds(interval));
+        char sep = ' ';
+        for(double rate : rates) {
+            printf("%c%'.0f", sep, rate);
+            sep = '/';
+        }
+        printf("\n");
+
+        // Throttling and frequency ramp-down show as a negative drift: the change of the mean of the last 10% of the samples
+        // relative to that of the first 10%.
+        size_t const n = rates.size();
+        size_t const tail = max_value(n / 10, size_t{1});
+        double mean = 0, first = 0, last = 0;
+        for(size_t i = 0; i < n; ++i) {
+            mean += rates[i];
+            first += i < tail ? rates[i] : 0;
+            last += i >= n - tail ? rates[i] : 0;
+        }
+        mean /= n;
+        double variance = 0;
+        for(double rate : rates)
+            variance += (rate - mean) * (rate - mean);
+        variance /= max_value(n - 1, size_t{1});
+        std::vector<double> sorted = rates;
+        std::sort(sorted.begin(), sorted.end());
+        printf("%32s,%2u,s  sustained %.0f sec: median %'.0f, min %'.0f, max %'.0f msg/sec, cv %.2f%%, drift %+.2f%%\n",
+               name, n_threads, to_seconds(sampler.times.back() - sampler.times.front()), sorted[n / 2], sorted.front(), sorted.back(),
+               mean ? std::sqrt(variance) / mean * 100 : 0, first ? (last / first - 1) * 100 : 0);
+
+        if(params->report)
+            params->report->add<Queue>({"sustained", name, n_threads, n_threads, 's', params->capacity,
+                                        sampler.received.back() - sampler.received.front(), std::move(intervals), {}, std::move(samples)});
+    });
+}
+
+ATOMIC_QUEUE_NOINLINE void run_sustained_benchmarks(Params const* params) {
+    unsigned const seconds = EnvBits64{"AQT", 60, 1, 24 * 3600}.value;
+    unsigned const interval_ms = EnvBits64{"AQI", 100, 1, 3600 * 1000}.value;
+    cycles_t const duration = seconds / TSC_TO_SECONDS;
+    cycles_t const interval = interval_ms * 1e-3 / TSC_TO_SECONDS;
+    unsigned const n_thread_max = params->hw_thread_ids.size() / 2;
+    printf("---- Running sustained throughput benchmarks with up to %u CPUs for %u seconds, sampling every %u milliseconds (stable is better) ----\n",
+           n_thread_max * 2, seconds, interval_ms);
+
+    for(auto const& queue : QueueRegistry::entries())
+        if((supported_suites(queue) & SUSTAINED) && !(params->options.value & queue.skipped_by))
+            queue.sustained(queue.name, params, duration, interval);
+
+    std::puts("\n");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// More producer and consumer threads than CPUs, as in oversubscribed containers. A thread preempted in the middle of a push or
+// pop, after it has claimed a slot but before it has stored or loaded the element, stalls the threads spinning on that slot for
+// up to a scheduler time slice. Both protocols spin on a claimed slot: the blocking push and pop of Optimist queues, as well as
+// try_push and try_pop of the AtomicQueue variants, which claim a slot by CAS and then wait for the preempted thread on that slot
+// just as push and pop do. Only the mutex queues block in the kernel.
+template<class Queue>
+ATOMIC_QUEUE_NOINLINE void time_oversubscribed(char const* name, Params const* params, unsigned n_threads) {
+    if(!in_thread_range(params, n_threads))
+        return;
+    run_selected(name, params, [&](Params const* params) {
+        time_throughput<Queue>(name, params, n_threads, n_threads);
+        time_latency<Queue>(name, params, n_threads, n_threads);
+    });
+}
+
+ATOMIC_QUEUE_NOINLINE void run_oversubscribed_benchmarks(Params const* params) {
+    unsigned const n_cpus = params->hw_thread_ids.size();
+    for(unsigned factor : {2, 4}) {
+        unsigned const n_threads = min_value(factor * n_cpus, decltype(SharedState::barrier)::max_threads) / 2; // Of each kind.
+        printf("---- Running oversubscribed benchmarks with %u producers and %u consumers on %u CPUs, %'d messages, best of %u runs "
+               "msg/sec (higher is better) and all runs latency (lower is better) ----\n",
+               n_threads, n_threads, n_cpus, params->n_msg, params->runs);
+
+        // Placement 'p' repeats the CPUs, rotated by one on each repetition, so that producers and consumers share CPUs.
+        Params oversubscribed = *params;
+        oversubscribed.placements = "pu";
+        oversubscribed.hw_thread_ids.resize(n_threads * 2);
+        for(unsigned i = 0; i < n_threads * 2; ++i)
+            oversubscribed.hw_thread_ids[i] = params->hw_thread_ids[(i + i / n_cpus) % n_cpus];
+        Params const* const p = &oversubscribed;
+
+        for(auto const& queue : QueueRegistry::entries())
+            if((supported_suites(queue) & OVERSUBSCRIBED) && !(params->options.value & queue.skipped_by))
+                queue.oversubscribed(queue.name, p, n_threads);
+
+        std::puts("\n");
+    }
+
+    set_thread_affinity(params->hw_thread_ids[0]); // Pin the main thread#0 back to CPU#0 after the unpinned runs.
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The synthetic work per message of work benchmarks, from a cheap to an expensive consumer.
+unsigned constexpr WORK_NS[] = {50, 100, 200, 500, 1000, 2000, 5000};
+
+struct WorkSize {
+    unsigned ns;
+    Work work;
+    double cycles; // Of the work per message on each side that does it.
+};
+
+// The cycles per iteration of do_work on this CPU.
+double calibrate_work() {
+    unsigned constexpr ITERATIONS = 10'000'000;
+    cycles_t n_cycles_best = CYCLES_MAX;
+    for(unsigned run = RUNS; run--;) {
+        cycles_t const start = cycles();
+        do_work(run, ITERATIONS);
+        n_cycles_best = min_value(n_cycles_best, cycles() - start);
+    }
+    return static_cast<double>(n_cycles_best) / ITERATIONS;
+}
+
+// The queue overhead is the fraction of the total time which isn't the work of the busiest thread: 0% when the queue costs
+// nothing, 100% without work.
+template<class Queue>
+ATOMIC_QUEUE_NOINLINE void time_work(char const* name, Params const* params, std::vector<WorkSize> const& work_sizes) {
+    run_selected(name, params, [&](Params const* params) {
+        unsigned const n_thread_max = params->hw_thread_ids.size() / 2;
+        for(auto& work_size : work_sizes) {
+            for(unsigned n_threads = 1; n_threads <= n_thread_max; n_threads *= 2) {
+                if(!in_thread_range(params, n_threads))
+                    continue;
+                int const n_producer_msg = (params->n_msg + (n_threads - 1)) / n_threads;
+                int const n_msg = n_producer_msg * n_threads;
+                isum_t const expected_sum = (n_producer_msg + 1) * .5 * n_producer_msg;
+                double const expected_avg_sum_inv = 1. / expected_sum;
+
+                Runs runs(params);
+                for(; runs.more(); HugePages::instance->check_huge_pages_leaks(name)) {
+                    ThreadStates threads(n_threads * 2);
+                    RunTimes const t = time_throughput_once<Queue>(params, n_threads, n_threads, 's', threads.data(),
+                                                                   {work_producer<Queue>, work_consumer<Queue>, nullptr, nullptr, nullptr, &work_size.work});
+                    check_sums(name, n_threads, threads, expected_sum * n_threads, expected_avg_sum_inv);
+                    runs.add(t.total);
+                }
+
+                RunStats const stats = runs.stats();
+                double const overhead = max_value(1 - n_producer_msg * work_size.cycles / stats.min, 0.);
+                printf("%32s,%2u,%4uns: %'11.0f msg/sec, queue overhead %5.1f%%, median %'11.0f msg/sec",
+                       name, n_threads, work_size.ns, n_msg / to_seconds(stats.min), overhead * 100, n_msg / to_seconds(stats.median));
+                print_variation(stats);
+                printf("\n");
+
+                if(params->report)
+                    params->report->add<Queue>({"work", name, n_threads, n_threads, 's', params->capacity, unsigned(n_msg),
+                                                runs.cycles(), {}, {}, work_size.ns});
+            }
+        }
+    });
+}
+
+ATOMIC_QUEUE_NOINLINE void run_work_benchmarks(Params const* params) {
+    unsigned const sides = EnvBits64{"AQW", 2, 1, 3}.value; // 1 - producers, 2 - consumers, 3 - both do the work.
+    double const cycles_per_iteration = calibrate_work();
+    std::vector<WorkSize> work_sizes;
+    for(unsigned ns : WORK_NS) {
+        double const work_cycles = ns * 1e-9 / TSC_TO_SECONDS;
+        unsigned const iterations = static_cast<unsigned>(work_cycles / cycles_per_iteration + .5);
+        work_sizes.push_back({ns, {sides & 1 ? iterations : 0, sides & 2 ? iterations : 0}, iterations * cycles_per_iteration});
+    }
+    char const* const side_names[] = {"", "producer", "consumer", "producer and consumer"};
+    printf("---- Running work per message benchmarks with up to %zu CPUs, %'d messages, %s work of %u to %'u ns per message at %.2f cycles "
+           "per iteration, best of %u runs (higher is better) ----\n",
+           params->hw_thread_ids.size() & -2, params->n_msg, side_names[sides], WORK_NS[0], WORK_NS[std::size(WORK_NS) - 1],
+           cycles_per_iteration, params->runs);
+
+    for(auto const& queue : QueueRegistry::entries())
+        if((supported_suites(queue) & WORK) && !(params->options.value & queue.skipped_by))
+            queue.work(queue.name, params, work_sizes);
+
+    std::puts("\n");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// One thread calls the queue operations n_msg times without contention, to separate the instruction path cost from the cache
+// coherence cost of the multi-threaded benchmarks.
+template<class Queue, class Op>
+ATOMIC_QUEUE_NOINLINE void time_single_thread(char const* name, char const* op_name, Params const* params, bool full, Op op) {
+    unsigned const n = params->n_msg;
+    cycles_t n_cycles_best = CYCLES_MAX;
+    std::uint64_t instructions_best = 0;
+    sum_t sum = 0;
+    unsigned n_runs = 0; // Including the warm-up runs.
+    Runs runs(params);
+    for(; runs.more(); ++n_runs, HugePages::instance->check_huge_pages_leaks(name)) {
+        auto queue = HugePages::instance->create_unique_ptr<Queue>();
+        if(full)
+            while(queue->try_push(1u))
+                ;
+        PerfCounters perf(params->perf_counters);
+
+        perf.start();
+        cycles_t const start = cycles();
+        sum += op(*queue, n);
+        cycles_t const n_cycles = cycles() - start;
+        perf.stop();
+
+        std::uint64_t counters[PerfCounters::N_EVENTS];
+        perf.read(counters);
+        if(runs.add(n_cycles) && n_cycles < n_cycles_best) {
+            n_cycles_best = n_cycles;
+            instructions_best = counters[PerfCounters::INSTRUCTIONS];
+        }
+    }
+    if(ATOMIC_QUEUE_UNLIKELY(sum != (full ? 0 : sum_t{n} * n_runs))) // Every operation either succeeded or failed.
+        fprintf(stderr, "%s,%s: wrong checksum error: %'llu.\n", name, op_name, sum);
+
+    RunStats const stats = runs.stats();
+    printf("%32s,%s: %7.2f cycles/op", name, op_name, static_cast<double>(n_cycles_best) / n);
+    if(PerfCounters::supported(PerfCounters::INSTRUCTIONS) && params->perf_counters)
+        printf(", %7.2f instructions/op", static_cast<double>(instructions_best) / n);
+    printf(", median %7.2f cycles/op", stats.median / n);
+    print_variation(stats);
+    printf("\n");
+}
+
+// An op is one push and one pop.
+template<class Queue>
+ATOMIC_QUEUE_INLINE void time_single_thread_push_pop(char const* name, Params const* params) {
+    time_single_thread<Queue>(name, "push+pop", params, false, [](Queue& q, unsigned n) {
+        sum_t sum = 0;
+        for(; n; --n) {
+            q.push(1u);
+            sum += q.pop();
+        }
+        return sum;
+    });
+}
+
+template<class Queue>
+ATOMIC_QUEUE_NOINLINE void time_single_thread_ops(char const* name, Params const* params) {
+    run_selected(name, params, [&](Params const* params) {
+        time_single_thread<Queue>(name, "try_push+try_pop", params, false, [](Queue& q, unsigned n) {
+            sum_t sum = 0;
+            for(unsigned element; n; --n) {
+                q.try_push(1u);
+                sum += q.try_pop(element) && element == 1;
+            }
+            return sum;
+        });
+        time_single_thread_push_pop<Queue>(name, params);
+        // The failure paths of polling an empty queue and of a producer finding the queue full.
+        time_single_thread<Queue>(name, "try_pop-empty", params, false, [](Queue& q, unsigned n) {
+            sum_t failures = 0;
+            for(unsigned element; n; --n)
+                failures += !q.try_pop(element);
+            return failures;
+        });
+        time_single_thread<Queue>(name, "try_push-full", params, true, [](Queue& q, unsigned n) {
+            sum_t successes = 0;
+            for(; n; --n)
+                successes += q.try_push(1u);
+            return successes;
+        });
+    });
+}
+
+// The RetryDecorator queues share try_push and try_pop with the Optimist queues, only their push and pop differ.
+template<class Queue>
+ATOMIC_QUEUE_NOINLINE void time_single_thread_retry(char const* name, Params const* params) {
+    run_selected(name, params, [&](Params const* params) {
+        time_single_thread_push_pop<Queue>(name, params);
+    });
+}
+
+ATOMIC_QUEUE_NOINLINE void run_single_thread_benchmarks(Params const* params) {
+    printf("---- Running single-thread benchmarks with %'d operations, best of %u runs, %s (lower is better) ----\n",
+           params->n_msg, params->runs, type_name<details::Remap>().c_str());
+
+    unsigned constexpr C = 4096; // Capacity. Fits into L1d cache, the smallest capacity of AtomicQueueB2.
+    using SPSC = QueueTypes<C, true, false, false>;
+    using MPMC = QueueTypes<C, false, true, true>; // With the index remap.
+
+    if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_1())) {
+        if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_a())) {
+            time_single_thread_ops<SPSC::OptimistAtomicQueue>("OptimistAtomicQueue,spsc", params);
+            time_single_thread_ops<MPMC::OptimistAtomicQueue>("OptimistAtomicQueue,mpmc", params);
+            time_single_thread_retry<SPSC::AtomicQueue>("AtomicQueue,spsc", params);
+            time_single_thread_retry<MPMC::AtomicQueue>("AtomicQueue,mpmc", params);
+        }
+        if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_b())) {
+            time_single_thread_ops<SPSC::OptimistAtomicQueueB>("OptimistAtomicQueueB,spsc", params);
+            time_single_thread_ops<MPMC::OptimistAtomicQueueB>("OptimistAtomicQueueB,mpmc", params);
+            time_single_thread_retry<SPSC::AtomicQueueB>("AtomicQueueB,spsc", params);
+            time_single_thread_retry<MPMC::AtomicQueueB>("AtomicQueueB,mpmc", params);
+        }
+    }
+
+    if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_2())) {
+        if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_a())) {
+            time_single_thread_ops<SPSC::OptimistAtomicQueue2>("OptimistAtomicQueue2,spsc", params);
+            time_single_thread_ops<MPMC::OptimistAtomicQueue2>("OptimistAtomicQueue2,mpmc", params);
+            time_single_thread_retry<SPSC::AtomicQueue2>("AtomicQueue2,spsc", params);
+            time_single_thread_retry<MPMC::AtomicQueue2>("AtomicQueue2,mpmc", params);
+        }
+        if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_b())) {
+            time_single_thread_ops<SPSC::OptimistAtomicQueueB2>("OptimistAtomicQueueB2,spsc", params);
+            time_single_thread_ops<MPMC::OptimistAtomicQueueB2>("OptimistAtomicQueueB2,mpmc", params);
+            time_single_thread_retry<SPSC::AtomicQueueB2>("AtomicQueueB2,spsc", params);
+            time_single_thread_retry<MPMC::AtomicQueueB2>("AtomicQueueB2,mpmc", params);
+        }
+    }
+
+    std::puts("\n");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template<class Queue>
+ATOMIC_QUEUE_NOINLINE void ping_pong_receiver(SharedState* ctx0, ThreadState* thread0) {
+#if ATOMIC_QUEUE_FULL_THROTTLE
     // Vacate the most desirable i386 registers with the shortest instruction encoding for more frequently accessed objects.
     // Move these rarely accessed objects into callee-saved [r12,15] registers, which often require 1-byte longer instruction encoding
     register auto* ctx asm("r14") = ctx0;
@@ -587,8 +2213,10 @@ ATOMIC_QUEUE_NOINLINE void ping_pong_receiver(SharedState* ctx0, ThreadState* th
     [[maybe_unused]] region_guard_t<Queue> guard;
     ConsumerOf<Queue> consumer_q1{*q1};
     ProducerOf<Queue> producer_q2{*q2};
+    PerfCounters perf(ctx->perf_counters);
 
-    ctx->barrier.countdown();
+    ctx->countdown(thread);
+    perf.start();
     thread->times.set(0);
 
     unsigned n;
@@ -598,6 +2226,8 @@ ATOMIC_QUEUE_NOINLINE void ping_pong_receiver(SharedState* ctx0, ThreadState* th
     } while(ATOMIC_QUEUE_LIKELY(n > 1));
 
     thread->times.set(1);
+    perf.stop();
+    perf.read(thread->counters);
 }
 
 template<class Queue>
@@ -621,8 +2251,10 @@ ATOMIC_QUEUE_NOINLINE void ping_pong_sender(SharedState* ctx0, ThreadState* thre
     ProducerOf<Queue> producer_q1{*q1};
     ConsumerOf<Queue> consumer_q2{*q2};
     unsigned n = ctx->n_producer_msg;
+    PerfCounters perf(ctx->perf_counters);
 
-    ctx->barrier.countdown();
+    ctx->countdown(thread);
+    perf.start();
     thread->times.set(0);
 
     do {
@@ -631,14 +2263,16 @@ ATOMIC_QUEUE_NOINLINE void ping_pong_sender(SharedState* ctx0, ThreadState* thre
     } while(ATOMIC_QUEUE_LIKELY(n-- > 1));
 
     thread->times.set(1);
+    perf.stop();
+    perf.read(thread->counters);
 }
 
 template<class Queue>
-ATOMIC_QUEUE_INLINE cycles_t time_ping_pong_once(Params const* params, unsigned const (&cpus)[2]) {
+ATOMIC_QUEUE_INLINE cycles_t time_ping_pong_once(Params const* params, unsigned const (&cpus)[2], PerfTotals* perf) {
     auto ctx = HugePages::instance->create_unique_ptr<SharedState2>(params, cpus);
     auto sender0 = ctx->use_this_thread(); // This thread#0 is the sender.
 
-    ContextOf<Queue> const queue_ctx{1, 1};
+    ContextOf<Queue> const queue_ctx{1, 1, params->capacity};
     auto q1 = HugePages::instance->create_unique_ptr<Queue>(queue_ctx);
     auto q2 = HugePages::instance->create_unique_ptr<Queue>(queue_ctx);
     ctx->queue0 = q1.get();
@@ -647,125 +2281,1134 @@ ATOMIC_QUEUE_INLINE cycles_t time_ping_pong_once(Params const* params, unsigned
     ctx->create_thread(ping_pong_receiver<Queue>);
     ping_pong_sender<Queue>(ctx.get(), sender0);
     ctx->join();
+    perf->add(ctx->as_thread_range());
 
     return ctx->total_time();
 }
 
 template<class Queue>
 ATOMIC_QUEUE_NOINLINE void time_ping_pong(char const* name, Params const* params) {
-    // Select the best times of RUNS runs.
-    cycles_t n_cycles_best = CYCLES_MAX;
+    run_selected(name, params, [&](Params const* params) {
+        // Select the best times of the runs and the statistics of the CPU pair with the best time.
+        std::optional<RunStats> best;
+        unsigned n_runs = 0;
+        PerfTotals perf;
+        StatsOf<Queue>::reset();
+
+        // Ping-pong between the first available CPU and every othery next power-of-2 to find its SMT sibling, if any.
+        auto& hw_thread_ids = params->hw_thread_ids;
+        unsigned const n_cpus = hw_thread_ids.size();
+        for(unsigned cpu2 = 1; cpu2 < n_cpus; cpu2 *= 2) {
+            unsigned const cpus[2] = {hw_thread_ids[0], hw_thread_ids[cpu2]};
+            Runs runs(params);
+            for(; runs.more(); HugePages::instance->check_huge_pages_leaks(name)) {
+                bool const warmup = runs.warmup();
+                PerfTotals warmup_perf;
+                auto n_cycles = time_ping_pong_once<Queue>(params, cpus, warmup ? &warmup_perf : &perf);
+                runs.add(n_cycles);
+                if(warmup)
+                    StatsOf<Queue>::reset();
+            }
+            RunStats const stats = runs.stats();
+            n_runs += stats.n;
+            if(!best || stats.min < best->min)
+                best = stats;
+            if(params->report)
+                params->report->add<Queue>({"ping-pong", name, 1, 1, 0, 0, unsigned(params->n_msg), runs.cycles(), {cpus[0], cpus[1]}});
+        }
+
+        auto const sec_round_trip = [params](double n_cycles) { return to_seconds(n_cycles * 2) / params->n_msg; };
+        printf("%32s: %.9f sec/round-trip, median %.9f sec/round-trip", name, sec_round_trip(best->min), sec_round_trip(best->median));
+        print_variation(*best);
+        printf("\n");
+        print_stats<Queue>(name, n_runs);
+        if(params->perf_counters)
+            perf.print(name, n_runs, static_cast<double>(params->n_msg) * n_runs);
+    });
+}
 
-    // Ping-pong between the first available CPU and every othery next power-of-2 to find its SMT sibling, if any.
-    auto& hw_thread_ids = params->hw_thread_ids;
-    unsigned const n_cpus = hw_thread_ids.size();
-    for(unsigned cpu2 = 1; cpu2 < n_cpus; cpu2 *= 2) {
-        unsigned const cpus[2] = {hw_thread_ids[0], hw_thread_ids[cpu2]};
-        for(unsigned run = RUNS; run--; HugePages::instance->check_huge_pages_leaks(name)) {
-            auto n_cycles = time_ping_pong_once<Queue>(params, cpus);
-            n_cycles_best = min_value(n_cycles_best, n_cycles);
+void run_ping_pong_benchmarks(Params const* params) {
+    printf("---- Running ping-pong benchmarks with 2 CPUs, %'d messages, best of %u runs (lower is better) ----\n", params->n_msg, params->runs);
+
+    for(auto& queue : QueueRegistry::entries())
+        if(!(params->options.value & queue.skipped_by))
+            queue.ping_pong(queue.name, params);
+
+    std::puts("\n");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The default numbers of messages in flight of windowed ping-pong benchmarks, and the maximum.
+unsigned constexpr WINDOW_DEPTHS[] = {1, 4, 16, 64};
+unsigned constexpr WINDOW_MAX = 64;
+
+// The windowed ping-pong receiver reads each request and sends it back as the response.
+template<class Queue>
+ATOMIC_QUEUE_NOINLINE void window_receiver(SharedState* ctx, ThreadState* thread) {
+    using M = Message<ElementOf<Queue>>;
+    Queue* ATOMIC_QUEUE_RESTRICT q1 = static_cast<Queue*>(ctx->queue0);
+    Queue* ATOMIC_QUEUE_RESTRICT q2 = static_cast<Queue*>(ctx->queue1);
+
+    [[maybe_unused]] region_guard_t<Queue> guard;
+    ConsumerOf<Queue> consumer_q1{*q1};
+    ProducerOf<Queue> producer_q2{*q2};
+
+    ctx->countdown(thread);
+    thread->times.set(0);
+
+    for(unsigned n = ctx->n_producer_msg; ATOMIC_QUEUE_LIKELY(n--);)
+        producer_q2.push(*q2, M::make(M::value(consumer_q1.pop(*q1))));
+
+    thread->times.set(1);
+}
+
+// The windowed ping-pong sender keeps ctx->window requests in flight: it sends the next request as soon as a response arrives,
+// and records the round-trip latency of each one from the time stamp the response carries back.
+template<class Queue>
+ATOMIC_QUEUE_NOINLINE void window_sender(SharedState* ctx, ThreadState* thread) {
+    using M = Message<ElementOf<Queue>>;
+    Queue* ATOMIC_QUEUE_RESTRICT q1 = static_cast<Queue*>(ctx->queue0);
+    Queue* ATOMIC_QUEUE_RESTRICT q2 = static_cast<Queue*>(ctx->queue1);
+
+    [[maybe_unused]] region_guard_t<Queue> guard;
+    ProducerOf<Queue> producer_q1{*q1};
+    ConsumerOf<Queue> consumer_q2{*q2};
+    LatencyHistogram& histogram = ctx->histograms[0];
+    unsigned const window = min_value(ctx->window, ctx->n_producer_msg);
+
+    auto const receive = [&]() {
+        unsigned const stamp = M::value(consumer_q2.pop(*q2));
+        histogram.record(max_value(as_signed(latency_stamp(cycles()) - stamp), 0)); // Bit 1 of stamps may make a latency negative.
+    };
+
+    ctx->countdown(thread);
+    thread->times.set(0);
+
+    for(unsigned n = window; n--;)
+        producer_q1.push(*q1, M::make(latency_stamp(cycles())));
+    for(unsigned n = ctx->n_producer_msg - window; ATOMIC_QUEUE_LIKELY(n--);) {
+        receive();
+        producer_q1.push(*q1, M::make(latency_stamp(cycles())));
+    }
+    for(unsigned n = window; n--;)
+        receive();
+
+    thread->times.set(1);
+}
+
+template<class Queue>
+ATOMIC_QUEUE_INLINE cycles_t time_window_once(Params const* params, unsigned const (&cpus)[2], unsigned window, LatencyHistogram* histogram) {
+    auto ctx = HugePages::instance->create_unique_ptr<SharedState2>(params, cpus);
+    auto sender0 = ctx->use_this_thread(); // This thread#0 is the sender.
+    ctx->histograms = histogram;
+    ctx->window = window;
+
+    ContextOf<Queue> const queue_ctx{1, 1, params->capacity};
+    auto q1 = HugePages::instance->create_unique_ptr<Queue>(queue_ctx);
+    auto q2 = HugePages::instance->create_unique_ptr<Queue>(queue_ctx);
+    ctx->queue0 = q1.get();
+    ctx->queue1 = q2.get();
+
+    ctx->create_thread(window_receiver<Queue>);
+    window_sender<Queue>(ctx.get(), sender0);
+    ctx->join();
+
+    return ctx->total_time();
+}
+
+template<class Queue>
+ATOMIC_QUEUE_NOINLINE void time_window(char const* name, Params const* params, std::vector<unsigned> const& windows) {
+    run_selected(name, params, [&](Params const* params) {
+        unsigned const cpus[2] = {params->hw_thread_ids[0], params->hw_thread_ids[1]};
+        for(unsigned window : windows) {
+            auto total = std::make_unique<LatencyHistogram>(); // The round-trip latencies of all runs.
+            Runs runs(params);
+            for(; runs.more(); HugePages::instance->check_huge_pages_leaks(name)) {
+                auto histogram = std::make_unique<LatencyHistogram>();
+                if(runs.add(time_window_once<Queue>(params, cpus, window, histogram.get())))
+                    total->merge(*histogram);
+            }
+
+            std::vector<unsigned> percentiles;
+            printf("%32s,%2u: round-trip", name, window);
+            for(auto& p : LATENCY_PERCENTILES) {
+                percentiles.push_back(total->percentile(p.p));
+                printf(" %s %'u,", p.name, percentiles.back());
+            }
+            percentiles.push_back(total->max());
+            printf(" max %'u cycles, %'11.0f msg/sec\n", percentiles.back(), params->n_msg / to_seconds(runs.stats().min));
+
+            if(params->report)
+                params->report->add<Queue>({"window", name, 1, 1, 0, 0, unsigned(params->n_msg), runs.cycles(), {cpus[0], cpus[1]}, {}, 0,
+                                            std::move(percentiles), window});
         }
+    });
+}
+
+std::vector<unsigned> get_windows(char const* env_name) {
+    char const* s = std::getenv(env_name);
+    if(!s)
+        return {std::begin(WINDOW_DEPTHS), std::end(WINDOW_DEPTHS)};
+    std::vector<unsigned> windows;
+    for(;;) {
+        char* end;
+        unsigned long const window = std::strtoul(s, &end, 10);
+        if(end == s || !window || window > WINDOW_MAX)
+            throw std::out_of_range(env_name);
+        windows.push_back(window);
+        if(!*end)
+            break;
+        if(*end != ',')
+            throw std::out_of_range(env_name);
+        s = end + 1;
+    }
+    return windows;
+}
+
+template<class T>
+ATOMIC_QUEUE_NOINLINE void run_window_benchmarks(Params const* params, std::vector<unsigned> const& windows) {
+    unsigned constexpr C = WINDOW_MAX * 2; // Capacity. Neither queue is ever full, boost::lockfree::spsc_queue holds C - 1 elements.
+    using SPSC = QueueTypes<C, true, false, false, T>;
+
+    char name[64];
+    auto as_name = [&name](char const* queue) {
+        std::snprintf(name, sizeof name, "%s<%zuB>", queue, sizeof(T));
+        return name;
+    };
+
+    time_window<BoostSpScAdapter<boost::lockfree::spsc_queue<T, boost::lockfree::capacity<C>>>>(as_name("boost::lockfree::spsc_queue"), params, windows);
+
+    if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_a())) {
+        time_window<typename SPSC::AtomicQueue2>(as_name("AtomicQueue2"), params, windows);
+        time_window<typename SPSC::OptimistAtomicQueue2>(as_name("OptimistAtomicQueue2"), params, windows);
+    }
+
+    if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_b())) {
+        time_window<typename SPSC::AtomicQueueB2>(as_name("AtomicQueueB2"), params, windows);
+        time_window<typename SPSC::OptimistAtomicQueueB2>(as_name("OptimistAtomicQueueB2"), params, windows);
     }
 
-    auto sec_round_trip = to_seconds(n_cycles_best * 2) / params->n_msg;
-    printf("%32s: %.9f sec/round-trip\n", name, sec_round_trip);
+    if(ATOMIC_QUEUE_LIKELY(!params->options.minimal())) {
+        time_window<MoodyCamelReaderWriterQueue<T, C>>(as_name("moodycamel::ReaderWriterQueue"), params, windows);
+        time_window<MoodyCamelQueue<T, C>>(as_name("moodycamel::ConcurrentQueue"), params, windows);
+        time_window<TbbAdapter<tbb::concurrent_bounded_queue<T>, C>>(as_name("tbb::concurrent_bounded_queue"), params, windows);
+        time_window<RetryDecorator<CapacityArgAdaptor<xenium::vyukov_bounded_queue<T>, C>>>(as_name("xenium::vyukov_bounded_queue"), params, windows);
+        time_window<BoostQueueAdapter<boost::lockfree::queue<T, BoostAllocator, boost::lockfree::capacity<C>>>>(
+            as_name("boost::lockfree::queue"), params, windows);
+    }
 }
 
-void run_ping_pong_benchmarks(Params const* params) {
-    printf("---- Running ping-pong benchmarks with 2 CPUs, %'d messages, best of %d runs (lower is better) ----\n", params->n_msg, RUNS);
+// Ping-pong with up to WINDOW_MAX requests in flight, as request/response paths keep, and 4 to 256-byte elements.
+ATOMIC_QUEUE_NOINLINE void run_window_benchmarks(Params const* params) {
+    std::vector<unsigned> const windows = get_windows("AQD");
+    printf("---- Running windowed ping-pong benchmarks with 2 CPUs, %'d messages, %u to %u messages in flight, 4 to 256-byte elements, "
+           "all of %u runs (lower is better) ----\n",
+           params->n_msg, *std::min_element(windows.begin(), windows.end()), *std::max_element(windows.begin(), windows.end()), params->runs);
+    run_window_benchmarks<unsigned>(params, windows);
+    run_window_benchmarks<Payload<8>>(params, windows);
+    run_window_benchmarks<Payload<32>>(params, windows);
+    std::puts("\n");
+}
 
-    // This benchmark doesn't require queue capacity greater than 1, however, capacity of 1 elides
-    // some instructions completely because of (x % 1) is always 0. Use something greater than 1 to
-    // preclude aggressive optimizations.
-    constexpr unsigned C = 8; // Capacity.
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-    // The reference.
-    time_ping_pong<BoostSpScAdapter<boost::lockfree::spsc_queue<unsigned, boost::lockfree::capacity<C>>>>(
-        "boost::lockfree::spsc_queue", params);
+// The closest resource two CPUs share, which determines the cost of moving cache lines between them.
+enum class CpuPair { CORE, LLC, SOCKET, REMOTE };
+char const* const CPU_PAIR_NAMES[] = {"same core", "same LLC", "same socket", "cross-socket"};
 
-    // Use MAXIMIZE_THROUGHPUT=false for better latency.
-    using SPSC = QueueTypes<C, true, false, false>;
+CpuPair classify(CpuTopologyInfo const& a, CpuTopologyInfo const& b) noexcept {
+    if(a.socket_id != b.socket_id)
+        return CpuPair::REMOTE;
+    if(a.core_id == b.core_id)
+        return CpuPair::CORE;
+    return a.llc_id == b.llc_id ? CpuPair::LLC : CpuPair::SOCKET;
+}
 
-    if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_1())) {
-        if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_a())) {
-            time_ping_pong<SPSC::AtomicQueue>("AtomicQueue", params);
-            time_ping_pong<SPSC::OptimistAtomicQueue>("OptimistAtomicQueue", params);
+template<class Queue>
+ATOMIC_QUEUE_NOINLINE void time_latency_matrix(char const* name, Params const* params, std::vector<CpuTopologyInfo> const& cpus) {
+    run_selected(name, params, [&](Params const* params) {
+        unsigned const n = cpus.size();
+        std::vector<double> matrix(n * n); // The best round-trip nanoseconds of each pair.
+        std::vector<double> by_class[4];
+        PerfTotals perf;
+
+        for(unsigned i = 0; i < n; ++i) {
+            for(unsigned j = i + 1; j < n; ++j) {
+                unsigned const pair[2] = {cpus[i].hw_thread_id, cpus[j].hw_thread_id};
+                Runs runs(params);
+                for(; runs.more(); HugePages::instance->check_huge_pages_leaks(name)) {
+                    PerfTotals warmup_perf;
+                    runs.add(time_ping_pong_once<Queue>(params, pair, runs.warmup() ? &warmup_perf : &perf));
+                }
+                double const ns = to_seconds(runs.stats().min * 2) / params->n_msg * 1e9;
+                matrix[i * n + j] = matrix[j * n + i] = ns;
+                by_class[static_cast<int>(classify(cpus[i], cpus[j]))].push_back(ns);
+
+                if(params->report)
+                    params->report->add<Queue>({"latency-matrix", name, 1, 1, 0, 0, unsigned(params->n_msg), runs.cycles(), {pair[0], pair[1]}});
+            }
         }
 
-        if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_b())) {
-            time_ping_pong<SPSC::AtomicQueueB>("AtomicQueueB", params);
-            time_ping_pong<SPSC::OptimistAtomicQueueB>("OptimistAtomicQueueB", params);
+        // A round trip crosses between the CPUs both ways, so each pair runs once and the matrix is symmetric.
+        printf("%s round-trip nanoseconds of each pair of CPUs\n  cpu", name);
+        for(auto& cpu : cpus)
+            printf("%6u", cpu.hw_thread_id);
+        for(unsigned i = 0; i < n; ++i) {
+            printf("\n%5u", cpus[i].hw_thread_id);
+            for(unsigned j = 0; j < n; ++j) {
+                if(i == j)
+                    printf("     -");
+                else
+                    printf("%6.0f", matrix[i * n + j]);
+            }
+        }
+        printf("\n");
+
+        for(unsigned c = 0; c < 4; ++c) {
+            auto& ns = by_class[c];
+            if(ns.empty())
+                continue;
+            std::sort(ns.begin(), ns.end());
+            printf("%32s  %s pairs %zu: round-trip min %.0f, median %.0f, max %.0f nsec\n",
+                   name, CPU_PAIR_NAMES[c], ns.size(), ns.front(), ns[ns.size() / 2], ns.back());
         }
+    });
+}
+
+// Measures the round-trip latency of every pair of up to AQM CPUs. Larger machines are sampled by whole cores evenly, so that
+// the matrix still contains pairs of every class.
+ATOMIC_QUEUE_NOINLINE void run_latency_matrix_benchmarks(Params const* params, std::vector<CpuTopologyInfo> const& cpu_topology) {
+    unsigned const max_cpus = EnvBits64{"AQM", 16, 2, UINT_MAX}.value;
+
+    std::vector<std::vector<CpuTopologyInfo>> cores;
+    for(auto& cpu : sort_by_core_id(cpu_topology)) {
+        if(cores.empty() || cores.back()[0].socket_id != cpu.socket_id || cores.back()[0].core_id != cpu.core_id)
+            cores.emplace_back();
+        cores.back().push_back(cpu);
     }
+    unsigned const n_cores = cores.size();
+    unsigned const n_cpus = cpu_topology.size();
+    unsigned const n_sampled = min_value(n_cores, max_value(min_value(max_cpus, n_cpus) * n_cores / n_cpus, 2u));
+    std::vector<CpuTopologyInfo> cpus;
+    for(unsigned i = 0; i < n_sampled; ++i)
+        for(auto& cpu : cores[i * n_cores / n_sampled])
+            cpus.push_back(cpu);
+
+    printf("---- Running ping-pong latency matrix benchmarks with %zu of %u CPUs, %'d messages, best of %u runs (lower is better) ----\n",
+           cpus.size(), n_cpus, params->n_msg, params->runs);
+    using SPSC = QueueTypes<8, true, false, false>; // The ping-pong benchmark capacity.
+    time_latency_matrix<SPSC::OptimistAtomicQueue>("OptimistAtomicQueue", params, cpus);
 
-    if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_2())) {
-        if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_a())) {
-            time_ping_pong<SPSC::AtomicQueue2>("AtomicQueue2", params);
-            time_ping_pong<SPSC::OptimistAtomicQueue2>("OptimistAtomicQueue2", params);
+    std::puts("\n");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The consumer is slower than the producers. The producers of a lossy OverwriteQueue overwrite the oldest messages and never
+// wait for the consumer, the producer of a blocking queue waits for the consumer when the queue is full.
+unsigned constexpr OVERWRITE_CONSUMER_PAUSES = 8;
+
+template<class Queue>
+ATOMIC_QUEUE_NOINLINE void overwrite_producer(SharedState* ctx, ThreadState* thread) {
+    Queue* const queue = static_cast<Queue*>(ctx->queue0);
+    unsigned n = ctx->n_producer_msg;
+    cycles_t* ATOMIC_QUEUE_RESTRICT push_cycles = static_cast<cycles_t*>(ctx->queue1) + (thread - ctx->threads) * n;
+
+    ctx->countdown(thread);
+    thread->times.set(0);
+
+    do {
+        cycles_t const t0 = cycles();
+        queue->push(n);
+        *push_cycles++ = cycles() - t0;
+    } while(ATOMIC_QUEUE_LIKELY(--n));
+
+    thread->times.set(1);
+
+    // The last producer pushes the stop message after all other messages, so that no message overwrites it.
+    if(ctx->producers_left.fetch_sub(1, AR) == 1)
+        queue->push(0);
+}
+
+template<class Queue>
+ATOMIC_QUEUE_NOINLINE void overwrite_consumer(SharedState* ctx, ThreadState* thread) {
+    Queue* const queue = static_cast<Queue*>(ctx->queue0);
+    sum_t received = 0;
+
+    ctx->countdown(thread);
+    thread->times.set(0);
+
+    while(ATOMIC_QUEUE_LIKELY(queue->pop())) {
+        ++received;
+        for(unsigned i = OVERWRITE_CONSUMER_PAUSES; i--;)
+            spin_loop_pause();
+    }
+
+    thread->sum.store(received, X);
+    thread->times.set(1);
+}
+
+// The messages the consumer of a lossy queue has skipped.
+template<class T, unsigned SIZE, bool SPSC>
+ATOMIC_QUEUE_INLINE unsigned dropped_of(OverwriteQueue<T, SIZE, SPSC> const& queue) noexcept {
+    return queue.dropped();
+}
+
+template<class Queue>
+ATOMIC_QUEUE_INLINE unsigned dropped_of(Queue const&) noexcept {
+    return 0; // A blocking queue.
+}
+
+template<class T>
+ATOMIC_QUEUE_INLINE T percentile(std::vector<T> const& sorted, double p) noexcept {
+    return sorted[min_value(static_cast<size_t>(sorted.size() * p), sorted.size() - 1)];
+}
+
+// Prints the push latency, received and dropped messages of the run with the fastest producers.
+template<class Queue>
+ATOMIC_QUEUE_NOINLINE void time_overwrite(char const* name, Params const* params, unsigned n_producers) {
+    run_selected(name, params, [&](Params const* params) {
+        unsigned const n_msg = (params->n_msg + (n_producers - 1)) / n_producers * n_producers;
+        std::vector<cycles_t> push_cycles(n_msg);
+        cycles_t best_cycles = CYCLES_MAX;
+        cycles_t best_push_cycles[4]; // p50, p99, p99.9 and max.
+        sum_t best_received = 0;
+        unsigned best_dropped = 0;
+
+        Runs runs(params);
+        for(; runs.more(); HugePages::instance->check_huge_pages_leaks(name)) {
+            ThreadStates threads(n_producers + 1);
+            auto ctx = HugePages::instance->create_unique_ptr<SharedState>(params, int(n_producers), 1, threads.data());
+            auto queue = HugePages::instance->create_unique_ptr<Queue>();
+            ctx->queue0 = queue.get();
+            ctx->queue1 = push_cycles.data();
+
+            auto* producer0 = ctx->use_this_thread(); // This thread#0 is the first producer.
+            for(unsigned i = 1; i < n_producers; ++i)
+                ctx->create_thread(overwrite_producer<Queue>);
+            ctx->create_thread(overwrite_consumer<Queue>);
+            overwrite_producer<Queue>(ctx.get(), producer0);
+            ctx->join();
+
+            // The time of the producers only, which don't wait for the consumer of a lossy queue.
+            cycles_t start = CYCLES_MAX;
+            cycles_t end = 0;
+            for(auto& thr : as_range(threads.data(), n_producers)) {
+                start = min_value(start, thr.times.get(0));
+                end = max_value(end, thr.times.get(1));
+            }
+            cycles_t const n_cycles = end - start;
+            if(!runs.add(n_cycles) || n_cycles >= best_cycles)
+                continue; // A warm-up run or a slower one.
+
+            best_cycles = n_cycles;
+            std::sort(push_cycles.begin(), push_cycles.end());
+            best_push_cycles[0] = percentile(push_cycles, .5);
+            best_push_cycles[1] = percentile(push_cycles, .99);
+            best_push_cycles[2] = percentile(push_cycles, .999);
+            best_push_cycles[3] = push_cycles.back();
+            best_received = threads[n_producers].sum.load(X);
+            best_dropped = dropped_of(*queue);
         }
 
-        if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_b())) {
-            time_ping_pong<SPSC::AtomicQueueB2>("AtomicQueueB2", params);
-            time_ping_pong<SPSC::OptimistAtomicQueueB2>("OptimistAtomicQueueB2", params);
+        printf("%32s,%2u: push latency p50 %'llu, p99 %'llu, p99.9 %'llu, max %'llu cycles, producers %'.0f msg/sec, "
+               "received %.2f%%, dropped %'u messages",
+               name, n_producers,
+               static_cast<unsigned long long>(best_push_cycles[0]),
+               static_cast<unsigned long long>(best_push_cycles[1]),
+               static_cast<unsigned long long>(best_push_cycles[2]),
+               static_cast<unsigned long long>(best_push_cycles[3]),
+               n_msg / to_seconds(best_cycles),
+               best_received * 100. / n_msg,
+               best_dropped);
+        print_variation(runs.stats());
+        printf("\n");
+
+        if(params->report)
+            params->report->add<Queue>({"overwrite", name, n_producers, 1, 's', 0, n_msg, runs.cycles()});
+    });
+}
+
+void run_overwrite_benchmarks(Params const* params) {
+    // The contended MPSC push with all CPUs but the consumer's, at least 2 producers.
+    unsigned const n_producers_max = max_value(unsigned(params->hw_thread_ids.size()) - 1, 2u);
+    printf("---- Running overwrite benchmarks with up to %u producers, %'d messages, a slow consumer, best of %u runs (lower push latency is better) ----\n",
+           n_producers_max, params->n_msg, params->runs);
+
+    unsigned constexpr C = 1024; // Capacity.
+
+    time_overwrite<OverwriteQueue<unsigned, C, true>>("OverwriteQueue SPSC", params, 1);
+    time_overwrite<OverwriteQueue<unsigned, C, false>>("OverwriteQueue MPSC", params, 1);
+    time_overwrite<OverwriteQueue<unsigned, C, false>>("OverwriteQueue MPSC", params, n_producers_max);
+
+    // The blocking reference.
+    using SPSC = QueueTypes<C, true, false, false>;
+    time_overwrite<SPSC::AtomicQueue2>("AtomicQueue2", params, 1);
+    time_overwrite<SPSC::AtomicQueueB2>("AtomicQueueB2", params, 1);
+
+    std::puts("\n");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// One writer stores n_msg values into the cells of a LatestValueTable round-robin, while the readers keep loading the cells
+// round-robin until they load the last value stored.
+template<class Table>
+ATOMIC_QUEUE_NOINLINE void latest_value_writer(SharedState* ctx, ThreadState* thread) {
+    Table* const table = static_cast<Table*>(ctx->queue0);
+    unsigned const n_msg = ctx->n_producer_msg;
+
+    ctx->countdown(thread);
+    thread->times.set(0);
+
+    for(unsigned n = 1, key = 0; n <= n_msg; ++n) {
+        typename Table::value_type value;
+        value.words[0] = n;
+        table->store(key, value);
+        if(ATOMIC_QUEUE_UNLIKELY(++key == Table::size()))
+            key = 0;
+    }
+
+    thread->times.set(1);
+}
+
+template<class Table>
+ATOMIC_QUEUE_NOINLINE void latest_value_reader(SharedState* ctx, ThreadState* thread) {
+    Table* const table = static_cast<Table*>(ctx->queue0);
+    unsigned const n_msg = ctx->n_producer_msg;
+    unsigned const last_key = (n_msg - 1) % Table::size();
+    sum_t n_loads = 0;
+
+    ctx->countdown(thread);
+    thread->times.set(0);
+
+    for(unsigned key = 0;; ++n_loads) {
+        auto const n = table->load(key).words[0];
+        if(ATOMIC_QUEUE_UNLIKELY(n == n_msg && key == last_key))
+            break;
+        if(ATOMIC_QUEUE_UNLIKELY(++key == Table::size()))
+            key = 0;
+    }
+
+    thread->sum.store(n_loads + 1, X);
+    thread->times.set(1);
+}
+
+template<class Table>
+ATOMIC_QUEUE_NOINLINE void time_latest_value(char const* name, Params const* params) {
+    run_selected(name, params, [&](Params const* params) {
+        unsigned const n_readers_max = params->hw_thread_ids.size() - 1;
+        for(unsigned n_readers = 1; n_readers <= n_readers_max; ++n_readers) {
+            // Both rates of the run with the fastest writer.
+            cycles_t best_write_cycles = CYCLES_MAX;
+            double writes_per_sec_best = 0;
+            double reads_per_sec_best = 0;
+
+            Runs runs(params);
+            for(; runs.more(); HugePages::instance->check_huge_pages_leaks(name)) {
+                ThreadStates threads(1 + n_readers);
+                auto ctx = HugePages::instance->create_unique_ptr<SharedState>(params, 1, int(n_readers), threads.data());
+                auto table = HugePages::instance->create_unique_ptr<Table>();
+                ctx->queue0 = table.get();
+
+                auto* writer0 = ctx->use_this_thread(); // This thread#0 is the writer.
+                for(unsigned i = 0; i < n_readers; ++i)
+                    ctx->create_thread(latest_value_reader<Table>);
+                latest_value_writer<Table>(ctx.get(), writer0);
+                ctx->join();
+
+                double reads_per_sec = 0;
+                for(auto& thr : as_range(threads.data() + 1, n_readers))
+                    reads_per_sec += thr.sum.load(X) / to_seconds(thr.times.get(1) - thr.times.get(0));
+                cycles_t const write_cycles = writer0->times.get(1) - writer0->times.get(0);
+                double const writes_per_sec = ctx->n_producer_msg / to_seconds(write_cycles);
+                if(!runs.add(write_cycles) || write_cycles >= best_write_cycles)
+                    continue; // A warm-up run or a slower one.
+
+                best_write_cycles = write_cycles;
+                writes_per_sec_best = writes_per_sec;
+                reads_per_sec_best = reads_per_sec;
+            }
+
+            printf("%32s,%2u: %'11.0f writes/sec %'13.0f reads/sec", name, n_readers, writes_per_sec_best, reads_per_sec_best);
+            print_variation(runs.stats());
+            printf("\n");
         }
+    });
+}
+
+void run_latest_value_benchmarks(Params const* params) {
+    printf("---- Running LatestValue benchmarks with 1 writer and up to %zu readers, %'d messages, best of %u runs (higher is better) ----\n",
+           params->hw_thread_ids.size() - 1, params->n_msg, params->runs);
+
+    time_latest_value<LatestValueTable<Payload<1>, 1>>("LatestValue<8B>", params);
+    time_latest_value<LatestValueTable<Payload<8>, 1>>("LatestValue<64B>", params);
+    time_latest_value<LatestValueTable<Payload<1>, 256>>("LatestValueTable<8B,256>", params);
+    time_latest_value<LatestValueTable<Payload<8>, 256>>("LatestValueTable<64B,256>", params);
+
+    std::puts("\n");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The queues with all combinations of the boolean template parameters, bits of FLAGS. AtomicQueueB and AtomicQueueB2 have no
+// MINIMIZE_CONTENTION parameter. Only the blocking push and pop, the try_push and try_pop retries have the same parameters.
+template<unsigned C, unsigned FLAGS, class T = unsigned>
+struct MatrixTypes {
+    static bool constexpr SPSC = FLAGS & 1;
+    static bool constexpr MINIMIZE_CONTENTION = FLAGS & 2;
+    static bool constexpr MAXIMIZE_THROUGHPUT = FLAGS & 4;
+    static bool constexpr TOTAL_ORDER = FLAGS & 8;
+
+    using Allocator = HugePageAllocator<T>;
+
+    using OptimistAtomicQueue =                       A::AtomicQueue<T, C, T{}, MINIMIZE_CONTENTION, MAXIMIZE_THROUGHPUT, TOTAL_ORDER, SPSC, BenchmarkStats>;
+    using OptimistAtomicQueueB = CapacityArgAdaptor<A::AtomicQueueB<T, Allocator, T{}, MAXIMIZE_THROUGHPUT, TOTAL_ORDER, SPSC, BenchmarkStats>, C>;
+    using OptimistAtomicQueue2 =                      A::AtomicQueue2<T, C, MINIMIZE_CONTENTION, MAXIMIZE_THROUGHPUT, TOTAL_ORDER, SPSC, BenchmarkStats>;
+    using OptimistAtomicQueueB2 = CapacityArgAdaptor<A::AtomicQueueB2<T, Allocator, MAXIMIZE_THROUGHPUT, TOTAL_ORDER, SPSC, BenchmarkStats>, C>;
+
+    // The queue name with the parameters which are true, e.g. OptimistAtomicQueue/mpmc/mc/mt. No commas, which separate the
+    // numbers of threads and placements in the results.
+    static std::string name(char const* queue) {
+        std::string s = queue;
+        s += SPSC ? "/spsc" : "/mpmc";
+        if(MINIMIZE_CONTENTION)
+            s += "/mc";
+        if(MAXIMIZE_THROUGHPUT)
+            s += "/mt";
+        if(TOTAL_ORDER)
+            s += "/to";
+        return s;
     }
+};
 
-    if(ATOMIC_QUEUE_LIKELY(!params->options.minimal())) {
-        time_ping_pong<MoodyCamelReaderWriterQueue<unsigned, C>>("moodycamel::ReaderWriterQueue", params);
-        time_ping_pong<MoodyCamelQueue<unsigned, C>>("moodycamel::ConcurrentQueue", params);
+unsigned constexpr N_MATRIX_FLAGS = 16;
+
+// The measurements of one scenario, ranked once all queues have run.
+struct MatrixScenario {
+    char const* title;
+    unsigned n_threads; // Producers and consumers each, 0 for ping-pong.
+    std::vector<std::pair<std::string, double>> results = {};
+};
+
+struct MatrixScenarios {
+    MatrixScenario ping_pong{"ping-pong", 0};
+    MatrixScenario spsc{"throughput, 1 producer, 1 consumer", 1};
+    MatrixScenario mpmc{"throughput, all CPUs", 0}; // n_threads is set at run-time.
+};
+
+template<class Queue>
+ATOMIC_QUEUE_NOINLINE void time_matrix_throughput(std::string const& name, Params const* params, MatrixScenario* scenario) {
+    unsigned const n_threads = scenario->n_threads;
+    int const n_producer_msg = (params->n_msg + (n_threads - 1)) / n_threads;
+    int const n_msg = n_producer_msg * n_threads;
+    isum_t const expected_sum = (n_producer_msg + 1) * .5 * n_producer_msg;
+
+    Runs runs(params);
+    for(; runs.more(); HugePages::instance->check_huge_pages_leaks(name.c_str())) {
+        ThreadStates threads(n_threads * 2);
+        runs.add(time_throughput_once<Queue>(params, n_threads, n_threads, 's', threads.data()).total);
+        check_sums(name.c_str(), n_threads, threads, expected_sum * n_threads, 1. / expected_sum);
+    }
+    scenario->results.emplace_back(name, n_msg / to_seconds(runs.stats().min));
 
-        time_ping_pong<TbbAdapter<tbb::concurrent_bounded_queue<unsigned>, C>>("tbb::concurrent_bounded_queue", params);
+    if(params->report)
+        params->report->add<Queue>({"matrix", name, n_threads, n_threads, 's', params->capacity, unsigned(n_msg), runs.cycles()});
+}
+
+template<class Queue>
+ATOMIC_QUEUE_NOINLINE void time_matrix_ping_pong(std::string const& name, Params const* params, MatrixScenario* scenario) {
+    unsigned const cpus[2] = {params->hw_thread_ids[0], params->hw_thread_ids[1]};
+    Runs runs(params);
+    PerfTotals perf;
+    for(; runs.more(); HugePages::instance->check_huge_pages_leaks(name.c_str()))
+        runs.add(time_ping_pong_once<Queue>(params, cpus, &perf));
+    scenario->results.emplace_back(name, to_seconds(runs.stats().min * 2) / params->n_msg);
+
+    if(params->report)
+        params->report->add<Queue>({"matrix", name, 1, 1, 0, 0, unsigned(params->n_msg), runs.cycles(), {cpus[0], cpus[1]}});
+}
 
-        time_ping_pong<XeniumQueueAdapter<xenium::michael_scott_queue<unsigned, xenium::policy::reclaimer<Reclaimer>>>>("xenium::michael_scott_queue", params);
-        time_ping_pong<XeniumQueueAdapter<xenium::ramalhete_queue<unsigned, xenium::policy::reclaimer<Reclaimer>>>>("xenium::ramalhete_queue", params);
-        time_ping_pong<RetryDecorator<CapacityArgAdaptor<xenium::vyukov_bounded_queue<unsigned>, C>>>("xenium::vyukov_bounded_queue", params);
+// Runs one combination of template parameters of each queue class in every scenario it supports.
+template<unsigned FLAGS>
+ATOMIC_QUEUE_NOINLINE void run_matrix_benchmarks(Params const* params, MatrixScenarios* scenarios, std::integer_sequence<unsigned, FLAGS>) {
+    using PingPong = MatrixTypes<8, FLAGS>; // The capacities of run_ping_pong_benchmarks and run_throughput_benchmarks.
+    using Throughput = MatrixTypes<128 * 1024, FLAGS>;
+    bool constexpr has_minimize_contention = FLAGS & 2;
+
+    auto run = [&](auto ping_pong, auto throughput, char const* queue) {
+        using P = typename decltype(ping_pong)::type;
+        using Q = typename decltype(throughput)::type;
+        std::string const name = PingPong::name(queue);
+        if(!selected(name.c_str(), params))
+            return;
+        time_matrix_ping_pong<P>(name, params, &scenarios->ping_pong);
+        time_matrix_throughput<Q>(name, params, &scenarios->spsc);
+        if(!PingPong::SPSC && scenarios->mpmc.n_threads > 1) // SPSC queues support 1 producer and 1 consumer only.
+            time_matrix_throughput<Q>(name, params, &scenarios->mpmc);
+    };
 
-        time_ping_pong<BoostQueueAdapter<boost::lockfree::queue<unsigned, BoostAllocator, boost::lockfree::capacity<C>>>>(
-            "boost::lockfree::queue", params);
+    if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_1())) {
+        if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_a()))
+            run(Type<typename PingPong::OptimistAtomicQueue>{}, Type<typename Throughput::OptimistAtomicQueue>{}, "OptimistAtomicQueue");
+        if constexpr(!has_minimize_contention)
+            if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_b()))
+                run(Type<typename PingPong::OptimistAtomicQueueB>{}, Type<typename Throughput::OptimistAtomicQueueB>{}, "OptimistAtomicQueueB");
+    }
+    if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_2())) {
+        if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_a()))
+            run(Type<typename PingPong::OptimistAtomicQueue2>{}, Type<typename Throughput::OptimistAtomicQueue2>{}, "OptimistAtomicQueue2");
+        if constexpr(!has_minimize_contention)
+            if(ATOMIC_QUEUE_LIKELY(!params->options.no_variant_b()))
+                run(Type<typename PingPong::OptimistAtomicQueueB2>{}, Type<typename Throughput::OptimistAtomicQueueB2>{}, "OptimistAtomicQueueB2");
+    }
+}
 
-        time_ping_pong<RetryDecorator<AtomicQueueSpinlock<unsigned, C>>>("pthread_spinlock", params);
-        time_ping_pong<RetryDecorator<AtomicQueueMutex<unsigned, C, std::mutex>>>("std::mutex", params);
-        time_ping_pong<RetryDecorator<AtomicQueueMutex<unsigned, C, tbb::spin_mutex>>>("tbb::spin_mutex", params);
-        // run_ping_pong_benchmark<RetryDecorator<AtomicQueueMutex<unsigned, C, AdaptiveMutex>>>("adaptive_mutex", params);
-        // run_ping_pong_benchmark<RetryDecorator<AtomicQueueMutex<unsigned, C, tbb::speculative_spin_mutex>>>("tbb::speculative_spin_mutex", params);
-        // time_ping_pong<RetryDecorator<AtomicQueueMutex<unsigned, C, TicketSpinlock>>>("TicketSpinlock", hp, hw_thread_ids);
-        // run_ping_pong_benchmark<RetryDecorator<AtomicQueueMutex<unsigned, C, UnfairSpinlock>>>("UnfairSpinlock", hp, hw_thread_ids);
-        // run_ping_pong_benchmark<RetryDecorator<AtomicQueueSpinlockHle<unsigned, C>>>("SpinlockHle");
+// Prints the results of a scenario from the best to the worst.
+void print_ranked(MatrixScenario& scenario, bool higher_is_better, char const* unit) {
+    auto& results = scenario.results;
+    if(results.empty())
+        return;
+    std::sort(results.begin(), results.end(), [higher_is_better](auto& a, auto& b) {
+        return higher_is_better ? a.second > b.second : a.second < b.second;
+    });
+    printf("---- Ranked %s ----\n", scenario.title);
+    double const best = results.front().second;
+    unsigned rank = 0;
+    for(auto& [name, value] : results) {
+        if(scenario.n_threads)
+            printf("%40s,%2u,s: %'11.0f %s, rank %2u, %6.1f%% of the best\n", name.c_str(), scenario.n_threads, value, unit, ++rank, value / best * 100);
+        else
+            printf("%40s: %.9f %s, rank %2u, %6.1f%% of the best\n", name.c_str(), value, unit, ++rank, value / best * 100);
     }
+    std::puts("");
+}
 
+template<unsigned... FLAGS>
+ATOMIC_QUEUE_NOINLINE void run_matrix_benchmarks(Params const* params, std::integer_sequence<unsigned, FLAGS...>) {
+    MatrixScenarios scenarios;
+    scenarios.mpmc.n_threads = params->hw_thread_ids.size() / 2;
+    printf("---- Running template parameter matrix benchmarks: ping-pong with 2 CPUs, throughput with 2 and %u CPUs, %'d messages, "
+           "best of %u runs ----\n", scenarios.mpmc.n_threads * 2, params->n_msg, params->runs);
+
+    // The ranking requires the results of all queues in one process.
+    run_isolated("*", params, [&](Params const* params) {
+        (run_matrix_benchmarks(params, &scenarios, std::integer_sequence<unsigned, FLAGS>{}), ...);
+
+        print_ranked(scenarios.ping_pong, false, "sec/round-trip");
+        print_ranked(scenarios.spsc, true, "msg/sec");
+        print_ranked(scenarios.mpmc, true, "msg/sec");
+    });
     std::puts("\n");
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+char const USAGE[] =
+    "Usage: %s [OPTION]...\n"
+    "Run the benchmarks enabled by environment variable AQB, see README.md.\n"
+    "\n"
+    "  -i, --include=REGEX    run the benchmarks with <benchmark>/<queue> names matching REGEX, e.g. 'throughput/Optimist';\n"
+    "                         enables all benchmarks, unless AQB is set; can be repeated\n"
+    "  -x, --exclude=REGEX    skip the benchmarks with names matching REGEX; can be repeated\n"
+    "  -t, --threads=MIN[-MAX]  the numbers of producers and consumers of the benchmarks with varying numbers of threads\n"
+    "  -r, --runs=N           the minimum number of runs of each measurement, default %d\n"
+    "  -w, --warmup=N         discard N runs before the measured runs of each measurement, default 0\n"
+    "  -c, --ci=PERCENT       run until the 95%% confidence interval of the mean is within PERCENT of the mean\n"
+    "  -m, --max-runs=N       the maximum number of runs with --ci, default %d\n"
+    "  -f, --format=FORMAT    text (default) or json, which prints the JSON report instead of the text results\n"
+    "  -l, --list             print the names of the selected benchmarks and the registered queues instead of running them\n"
+    "  -n, --no-fork          run all benchmarks in this process, rather than each benchmark of one queue in a child process\n"
+    "  -h, --help             print this help and exit\n";
+
+[[noreturn]] void usage(char const* argv0, int status) {
+    std::fprintf(status ? stderr : stdout, USAGE, argv0, RUNS, MAX_RUNS);
+    std::exit(status);
+}
+
+// All opt-in benchmarks of Options.
+unsigned long long constexpr ALL_BENCHMARKS = 256 | 512 | 1024 | 2048 | 4096 | 8192 | 16384 | 32768 | 65536 | 131072 | 262144 | 524288 | 1048576 | 2097152;
+
+// Returns whether the JSON format is selected.
+bool parse_command_line(int argc, char** argv, Params* params, Selection* selection) {
+    static ::option const options[] = {
+        {"include", required_argument, nullptr, 'i'},
+        {"exclude", required_argument, nullptr, 'x'},
+        {"threads", required_argument, nullptr, 't'},
+        {"runs",    required_argument, nullptr, 'r'},
+        {"warmup",  required_argument, nullptr, 'w'},
+        {"ci",      required_argument, nullptr, 'c'},
+        {"max-runs", required_argument, nullptr, 'm'},
+        {"format",  required_argument, nullptr, 'f'},
+        {"list",    no_argument,       nullptr, 'l'},
+        {"no-fork", no_argument,       nullptr, 'n'},
+        {"help",    no_argument,       nullptr, 'h'},
+        {}
+    };
+    auto const parse_runs = [argv](unsigned min) -> unsigned {
+        char* end;
+        long const runs = std::strtol(optarg, &end, 10);
+        if(*end || runs < min || runs > INT_MAX)
+            usage(argv[0], EXIT_FAILURE);
+        return runs;
+    };
+    bool json = false;
+    try {
+        for(int c; (c = ::getopt_long(argc, argv, "i:x:t:r:w:c:m:f:lnh", options, nullptr)) != -1;) {
+            switch(c) {
+            case 'i':
+                selection->include.emplace_back(optarg);
+                break;
+            case 'x':
+                selection->exclude.emplace_back(optarg);
+                break;
+            case 't': {
+                char* end;
+                params->threads_min = params->threads_max = std::strtol(optarg, &end, 10);
+                if(*end == '-')
+                    params->threads_max = std::strtol(end + 1, &end, 10);
+                if(*end || params->threads_min < 1 || params->threads_min > params->threads_max)
+                    usage(argv[0], EXIT_FAILURE);
+                break;
+            }
+            case 'r':
+                params->runs = parse_runs(1);
+                break;
+            case 'w':
+                params->warmup_runs = parse_runs(0);
+                break;
+            case 'c': {
+                char* end;
+                double const percent = std::strtod(optarg, &end);
+                if(*end || !(percent > 0 && percent < 100))
+                    usage(argv[0], EXIT_FAILURE);
+                params->ci = percent / 100;
+                break;
+            }
+            case 'm':
+                params->max_runs = parse_runs(2);
+                break;
+            case 'f':
+                if(!std::strcmp(optarg, "json"))
+                    json = true;
+                else if(std::strcmp(optarg, "text"))
+                    usage(argv[0], EXIT_FAILURE);
+                break;
+            case 'l':
+                selection->list = true;
+                break;
+            case 'n':
+                params->fork = false;
+                break;
+            case 'h':
+                usage(argv[0], EXIT_SUCCESS);
+            default:
+                usage(argv[0], EXIT_FAILURE);
+            }
+        }
+    }
+    catch(std::regex_error const& e) {
+        std::fprintf(stderr, "%s: invalid regular expression '%s': %s\n", argv[0], optarg, e.what());
+        usage(argv[0], EXIT_FAILURE);
+    }
+    if(optind != argc)
+        usage(argv[0], EXIT_FAILURE);
+
+    if(!selection->include.empty() && !std::getenv("AQB"))
+        params->options.value |= ALL_BENCHMARKS;
+    if(selection->list)
+        params->fork = false; // Nothing runs.
+    return json;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Registers a queue adaptor for the throughput, latency and open-loop benchmarks, which run ThroughputQueue, and the ping-pong
+// benchmarks, which run PingPongQueue. With SpscQueue, the throughput benchmarks run it with 1 producer and 1 consumer and
+// ThroughputQueue with 2 or more. AQB bits skipped_by skip the queue, see QueueOptions, and AQB no_spsc skips the runs with 1
+// producer and 1 consumer of queues with SpscQueue or SPSC_ONLY.
+//
+// The grid, sustained, oversubscribed and work suites, see QueueSuites and supported_suites, run ThroughputQueue too. Sustained
+// runs SpscQueue or SPSC_ONLY ThroughputQueue with 1 producer and 1 consumer and ThroughputQueue with half the CPUs of each kind.
+//
+// Additional queues, e.g. in-house ones, register the same way, e.g. with the capacities of the other queues:
+//
+//     RegisterQueue<MyQueue<unsigned, THROUGHPUT_C>, MyQueue<unsigned, PING_PONG_C>> const my_queue{"MyQueue"};
+//     RegisterQueue<MySpscQueue<unsigned, THROUGHPUT_C>, MySpscQueue<unsigned, PING_PONG_C>> const my_spsc_queue{"MySpscQueue", SPSC_ONLY};
+//
+// Build with CPPFLAGS='-DATOMIC_QUEUE_BENCHMARKS_QUEUES=\"my_queues.h\"' to include a header with such definitions. The queues
+// run after the built-in ones, in the order of the definitions. The window, payload, capacity, single-thread and matrix
+// benchmarks run the built-in queues only, with other element types and capacities, or the template parameters of this library.
+template<class ThroughputQueue, class PingPongQueue = ThroughputQueue, class SpscQueue = void>
+struct RegisterQueue : QueueRegistry {
+    explicit RegisterQueue(char const* name, unsigned capabilities = MPMC, unsigned long long skipped_by = 0, unsigned suites = ALL_SUITES)
+        : QueueRegistry(name, capabilities_of<ThroughputQueue>(capabilities), skipped_by, suites, throughput(capabilities),
+                        time_ping_pong<PingPongQueue>, time_grid<ThroughputQueue>, sustained(capabilities),
+                        time_oversubscribed<ThroughputQueue>, time_work<ThroughputQueue>)
+    {}
+
+    static decltype(QueueEntry::throughput) throughput(unsigned capabilities) {
+        if constexpr(std::is_void<SpscQueue>::value)
+            return capabilities & SPSC_ONLY ? throughput_spsc : throughput_mpmc;
+        else
+            return throughput_spsc_mpmc;
+    }
+
+    static void throughput_mpmc(char const* name, Params const* params) {
+        time_throughput_mpmc(name, params, Type<ThroughputQueue>{});
+    }
+
+    static void throughput_spsc(char const* name, Params const* params) {
+        if(ATOMIC_QUEUE_LIKELY(!params->options.no_spsc()))
+            time_throughput_spsc(name, params, Type<ThroughputQueue>{});
+    }
+
+    static void throughput_spsc_mpmc(char const* name, Params const* params) {
+        if(ATOMIC_QUEUE_LIKELY(!params->options.no_spsc()))
+            time_throughput_spsc(name, params, Type<SpscQueue>{});
+        time_throughput_mpmc(name, params, Type<ThroughputQueue>{}, 2);
+    }
+
+    static decltype(QueueEntry::sustained) sustained(unsigned capabilities) {
+        if constexpr(std::is_void<SpscQueue>::value)
+            return capabilities & SPSC_ONLY ? sustained_spsc : sustained_mpmc;
+        else
+            return sustained_spsc_mpmc;
+    }
+
+    static void sustained_mpmc(char const* name, Params const* params, cycles_t duration, cycles_t interval) {
+        time_sustained<ThroughputQueue>(name, params, params->hw_thread_ids.size() / 2, duration, interval);
+    }
+
+    static void sustained_spsc(char const* name, Params const* params, cycles_t duration, cycles_t interval) {
+        if(ATOMIC_QUEUE_LIKELY(!params->options.no_spsc()))
+            time_sustained<ThroughputQueue>(name, params, 1, duration, interval);
+    }
+
+    static void sustained_spsc_mpmc(char const* name, Params const* params, cycles_t duration, cycles_t interval) {
+        if(ATOMIC_QUEUE_LIKELY(!params->options.no_spsc()))
+            time_sustained<SpscQueue>(name, params, 1, duration, interval);
+        time_sustained<ThroughputQueue>(name, params, params->hw_thread_ids.size() / 2, duration, interval);
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The built-in queues, in the order of the results.
+
+unsigned constexpr THROUGHPUT_C = 128 * 1024; // The capacity of the queues of the throughput benchmarks.
+
+// The ping-pong benchmarks don't require queue capacity greater than 1, however, capacity of 1 elides some instructions
+// completely because of (x % 1) is always 0. Use something greater than 1 to preclude aggressive optimizations.
+unsigned constexpr PING_PONG_C = 8;
+
+template<unsigned C> using Spsc = QueueTypes<C, true, false, false>; // Ping-pong uses MAXIMIZE_THROUGHPUT=false for better latency.
+template<unsigned C> using Mpmc = QueueTypes<C, false, true, true>;   // Enable MAXIMIZE_THROUGHPUT for 2 or more producers/consumers.
+
+// The reference.
+RegisterQueue<BoostSpScAdapter<boost::lockfree::spsc_queue<unsigned, boost::lockfree::capacity<THROUGHPUT_C>>>,
+              BoostSpScAdapter<boost::lockfree::spsc_queue<unsigned, boost::lockfree::capacity<PING_PONG_C>>>> const
+    boost_spsc_queue{"boost::lockfree::spsc_queue", SPSC_ONLY, 0, 0};
+
+RegisterQueue<Mpmc<THROUGHPUT_C>::AtomicQueue, Spsc<PING_PONG_C>::AtomicQueue, Spsc<THROUGHPUT_C>::AtomicQueue> const
+    atomic_queue1{"AtomicQueue", MPMC, NO_VARIANT_1 | NO_VARIANT_A, GRID | OVERSUBSCRIBED | WORK};
+RegisterQueue<Mpmc<THROUGHPUT_C>::OptimistAtomicQueue, Spsc<PING_PONG_C>::OptimistAtomicQueue, Spsc<THROUGHPUT_C>::OptimistAtomicQueue> const
+    optimist_atomic_queue{"OptimistAtomicQueue", MPMC, NO_VARIANT_1 | NO_VARIANT_A};
+RegisterQueue<Mpmc<THROUGHPUT_C>::AtomicQueueB, Spsc<PING_PONG_C>::AtomicQueueB, Spsc<THROUGHPUT_C>::AtomicQueueB> const
+    atomic_queue_b{"AtomicQueueB", MPMC, NO_VARIANT_1 | NO_VARIANT_B, GRID | OVERSUBSCRIBED};
+RegisterQueue<Mpmc<THROUGHPUT_C>::OptimistAtomicQueueB, Spsc<PING_PONG_C>::OptimistAtomicQueueB, Spsc<THROUGHPUT_C>::OptimistAtomicQueueB> const
+    optimist_atomic_queue_b{"OptimistAtomicQueueB", MPMC, NO_VARIANT_1 | NO_VARIANT_B};
+
+RegisterQueue<Mpmc<THROUGHPUT_C>::AtomicQueue2, Spsc<PING_PONG_C>::AtomicQueue2, Spsc<THROUGHPUT_C>::AtomicQueue2> const
+    atomic_queue2{"AtomicQueue2", MPMC, NO_VARIANT_2 | NO_VARIANT_A, GRID | OVERSUBSCRIBED};
+RegisterQueue<Mpmc<THROUGHPUT_C>::OptimistAtomicQueue2, Spsc<PING_PONG_C>::OptimistAtomicQueue2, Spsc<THROUGHPUT_C>::OptimistAtomicQueue2> const
+    optimist_atomic_queue2{"OptimistAtomicQueue2", MPMC, NO_VARIANT_2 | NO_VARIANT_A};
+RegisterQueue<Mpmc<THROUGHPUT_C>::AtomicQueueB2, Spsc<PING_PONG_C>::AtomicQueueB2, Spsc<THROUGHPUT_C>::AtomicQueueB2> const
+    atomic_queue_b2{"AtomicQueueB2", MPMC, NO_VARIANT_2 | NO_VARIANT_B, GRID | OVERSUBSCRIBED};
+RegisterQueue<Mpmc<THROUGHPUT_C>::OptimistAtomicQueueB2, Spsc<PING_PONG_C>::OptimistAtomicQueueB2, Spsc<THROUGHPUT_C>::OptimistAtomicQueueB2> const
+    optimist_atomic_queue_b2{"OptimistAtomicQueueB2", MPMC, NO_VARIANT_2 | NO_VARIANT_B};
+
+RegisterQueue<MoodyCamelReaderWriterQueue<unsigned, THROUGHPUT_C>, MoodyCamelReaderWriterQueue<unsigned, PING_PONG_C>> const
+    moodycamel_reader_writer_queue{"moodycamel::ReaderWriterQueue", SPSC_ONLY, MINIMAL, 0};
+RegisterQueue<MoodyCamelQueue<unsigned, THROUGHPUT_C>, MoodyCamelQueue<unsigned, PING_PONG_C>> const
+    moodycamel_concurrent_queue{"moodycamel::ConcurrentQueue", PER_PRODUCER_FIFO, MINIMAL};
+
+RegisterQueue<TbbAdapter<tbb::concurrent_bounded_queue<unsigned>, THROUGHPUT_C>, TbbAdapter<tbb::concurrent_bounded_queue<unsigned>, PING_PONG_C>> const
+    tbb_concurrent_bounded_queue{"tbb::concurrent_bounded_queue", MPMC, MINIMAL, GRID | OVERSUBSCRIBED};
+
+RegisterQueue<XeniumQueueAdapter<xenium::michael_scott_queue<unsigned, xenium::policy::reclaimer<Reclaimer>>>> const
+    xenium_michael_scott_queue{"xenium::michael_scott_queue", MPMC, MINIMAL, 0};
+RegisterQueue<XeniumQueueAdapter<xenium::ramalhete_queue<unsigned, xenium::policy::reclaimer<Reclaimer>>>> const
+    xenium_ramalhete_queue{"xenium::ramalhete_queue", MPMC, MINIMAL, 0};
+RegisterQueue<RetryDecorator<CapacityArgAdaptor<xenium::vyukov_bounded_queue<unsigned>, THROUGHPUT_C>>,
+              RetryDecorator<CapacityArgAdaptor<xenium::vyukov_bounded_queue<unsigned>, PING_PONG_C>>> const
+    xenium_vyukov_bounded_queue{"xenium::vyukov_bounded_queue", MPMC, MINIMAL, GRID};
+
+unsigned constexpr BLQ_C_MAX = 0x10000 - 2;
+RegisterQueue<BoostQueueAdapter<boost::lockfree::queue<unsigned, BoostAllocator, boost::lockfree::capacity<min_value(THROUGHPUT_C, BLQ_C_MAX)>>>,
+              BoostQueueAdapter<boost::lockfree::queue<unsigned, BoostAllocator, boost::lockfree::capacity<PING_PONG_C>>>> const
+    boost_queue{"boost::lockfree::queue", MPMC, MINIMAL, 0};
+
+RegisterQueue<RetryDecorator<AtomicQueueSpinlock<unsigned, THROUGHPUT_C>>, RetryDecorator<AtomicQueueSpinlock<unsigned, PING_PONG_C>>> const
+    pthread_spinlock{"pthread_spinlock", MPMC, MINIMAL, 0};
+RegisterQueue<RetryDecorator<AtomicQueueMutex<unsigned, THROUGHPUT_C, std::mutex>>, RetryDecorator<AtomicQueueMutex<unsigned, PING_PONG_C, std::mutex>>> const
+    std_mutex{"std::mutex", MPMC, MINIMAL, GRID | OVERSUBSCRIBED | WORK};
+RegisterQueue<RetryDecorator<AtomicQueueMutex<unsigned, THROUGHPUT_C, tbb::spin_mutex>>, RetryDecorator<AtomicQueueMutex<unsigned, PING_PONG_C, tbb::spin_mutex>>> const
+    tbb_spin_mutex{"tbb::spin_mutex", MPMC, MINIMAL, 0};
+// TicketSpinlock, UnfairSpinlock, AdaptiveMutex, tbb::speculative_spin_mutex and AtomicQueueSpinlockHle register the same way.
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 } // namespace
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-int main() {
+#ifdef ATOMIC_QUEUE_BENCHMARKS_QUEUES
+#include ATOMIC_QUEUE_BENCHMARKS_QUEUES // Definitions of RegisterQueue objects.
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
     Params params;
+    Selection selection;
+    bool const json = parse_command_line(argc, argv, &params, &selection);
+    params.selection = &selection;
+
+    int json_fd = -1;
+    if(json) { // Print the report only, the text results go to /dev/null.
+        json_fd = ::dup(STDOUT_FILENO);
+        int const null_fd = ::open("/dev/null", O_WRONLY);
+        if(json_fd < 0 || null_fd < 0 || ::dup2(null_fd, STDOUT_FILENO) < 0)
+            throw std::system_error(errno, std::system_category(), "/dev/null");
+        ::close(null_fd);
+    }
 
     std::setlocale(LC_NUMERIC, ""); // Enable thousand separator, if set in user's locale.
 
-    TSC_TO_SECONDS = 1e-9 / cpu_base_frequency();
+    auto const tsc = tsc_frequency();
+    TSC_TO_SECONDS = 1e-9 / tsc.ghz;
+    printf("Time stamp counter frequency %.6f GHz from %s.\n", tsc.ghz, tsc.source);
 
     auto const cpu_topology = get_available_cpu_topology_info();
     log_cpus(cpu_topology);
     if(cpu_topology.size() < 2)
         throw std::runtime_error("A CPU with at least 2 hardware threads is required.");
+    if(cpu_topology.size() > decltype(SharedState::barrier)::max_threads)
+        throw std::runtime_error("Too many hardware threads for SharedState::barrier.");
 
     params.hw_thread_ids = hw_thread_id(cpu_topology); // Sorted by hw_thread_id.
+    params.llc_hw_thread_ids = hw_thread_id(sort_by_llc_id(cpu_topology));
+    if(count_llcs(cpu_topology) > 1) // Otherwise, the same as placement 'i'.
+        params.placements += 'l';
     set_thread_affinity(params.hw_thread_ids[0]); // Pin the main thread#0 to CPU#0 prior to allocating memory.
 
-    size_t constexpr MB = 1024 * 1024;
-    HugePages hp(HugePages::PAGE_1GB, 32 * MB); // Try allocating a 1GB huge page to minimize TLB misses.
-    HugePages::instance = &hp;
+    // Try allocating a 1GB huge page to minimize TLB misses. The child processes of the benchmarks allocate their own huge pages,
+    // then this allocation only warns once when huge pages are unavailable.
+    std::optional<HugePages> hp{std::in_place, HugePages::PAGE_1GB, huge_pages_size(params.options)};
+    if(params.fork) {
+        hp.reset();
+        HugePages::warn_no_1GB_pages = HugePages::warn_no_2MB_pages = nullptr;
+    }
+    else {
+        HugePages::instance = &*hp;
+    }
+
+    char const* const report_filename = std::getenv("AQJ");
+    Report report;
+    if(report_filename || json)
+        params.report = &report;
+    if(params.perf_counters)
+        params.perf_counters = PerfCounters::init(); // Run without the counters when they are unavailable.
+
+    // The names of the benchmarks prefix the names of the queues selected on the command line.
+    auto const benchmark = [&params](char const* name) {
+        params.benchmark = name;
+        return &params;
+    };
 
     if(!params.options.no_ping_pong())
-        run_ping_pong_benchmarks(&params);
+        run_ping_pong_benchmarks(benchmark("ping-pong"));
+
+    if(params.options.latency_matrix())
+        run_latency_matrix_benchmarks(benchmark("latency-matrix"), cpu_topology);
+
+    if(params.options.window())
+        run_window_benchmarks(benchmark("window"));
+
+    if(params.options.single_thread())
+        run_single_thread_benchmarks(benchmark("single-thread"));
 
     if(!params.options.no_throughput())
-        run_throughput_benchmarks(&params);
+        run_throughput_benchmarks(benchmark("throughput"));
+
+    if(params.options.latency()) {
+        Params latency_params = params;
+        latency_params.mode = Mode::LATENCY;
+        latency_params.benchmark = "latency";
+        run_throughput_benchmarks(&latency_params);
+    }
+
+    if(params.options.open_loop()) {
+        Params open_loop_params = params;
+        open_loop_params.mode = Mode::OPEN_LOOP;
+        open_loop_params.benchmark = "open-loop";
+        run_throughput_benchmarks(&open_loop_params);
+    }
+
+    if(params.options.payload())
+        run_payload_benchmarks(benchmark("payload"), std::integer_sequence<unsigned, 1, 2, 4, 8, 16, 32, 64>{}); // 8 to 512-byte payloads.
+
+    if(params.options.capacity())
+        run_capacity_benchmarks(benchmark("capacity"), std::integer_sequence<unsigned, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24>{}); // 64 to 16M elements.
+
+    if(params.options.grid())
+        run_grid_benchmarks(benchmark("grid"));
+
+    if(params.options.sustained())
+        run_sustained_benchmarks(benchmark("sustained"));
+
+    if(params.options.oversubscribed())
+        run_oversubscribed_benchmarks(benchmark("oversubscribed"));
+
+    if(params.options.work())
+        run_work_benchmarks(benchmark("work"));
+
+    if(params.options.matrix())
+        run_matrix_benchmarks(benchmark("matrix"), std::make_integer_sequence<unsigned, N_MATRIX_FLAGS>{});
+
+    if(params.options.overwrite())
+        run_overwrite_benchmarks(benchmark("overwrite"));
+
+    if(params.options.latest_value())
+        run_latest_value_benchmarks(benchmark("latest-value"));
+
+    if(selection.list) {
+        for(auto& queue : QueueRegistry::entries()) {
+            unsigned const suites = supported_suites(queue);
+            printf("Registered queue %s:%s%s%s%s, suites:%s%s%s%s\n", queue.name,
+                   queue.capabilities & SPSC_ONLY ? " spsc-only" : " mpmc",
+                   queue.capabilities & NEEDS_CONTEXT ? " needs-context" : "",
+                   queue.capabilities & TOKENS ? " tokens" : "",
+                   queue.capabilities & PER_PRODUCER_FIFO ? " per-producer-fifo" : "",
+                   suites & GRID ? " grid" : "",
+                   suites & SUSTAINED ? " sustained" : "",
+                   suites & OVERSUBSCRIBED ? " oversubscribed" : "",
+                   suites & WORK ? " work" : "");
+        }
+    }
+
+    if(report_filename)
+        report.write(report_filename, params, tsc);
+    if(json) {
+        std::unique_ptr<std::FILE, int(*)(std::FILE*)> f{::fdopen(json_fd, "w"), std::fclose};
+        if(!f)
+            throw std::system_error(errno, std::system_category(), "stdout");
+        report.write(f.get(), "stdout", params, tsc);
+    }
+
+    return n_failed_benchmarks ? EXIT_FAILURE : EXIT_SUCCESS;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -2,9 +2,12 @@
 #ifndef ATOMIC_QUEUE_BENCHMARKS_H_INCLUDED
 #define ATOMIC_QUEUE_BENCHMARKS_H_INCLUDED
 
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "atomic_queue/defs.h"
+#include "atomic_queue/stats.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -15,12 +18,17 @@ namespace atomic_queue {
 struct Context {
     int producers;
     int consumers;
+    unsigned capacity; // The run-time capacity for CapacityContextAdaptor.
 };
 
 template<class T> typename T::ContextType context_of_(int);
 template<class T> NoContext context_of_(long);
 template<class T> using ContextOf = decltype(context_of_<T>(0));
 
+template<class T> typename T::stats_type stats_of_(int);
+template<class T> NoStats stats_of_(long);
+template<class T> using StatsOf = decltype(stats_of_<T>(0));
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 struct NoToken {
@@ -46,6 +54,8 @@ template<class T> typename T::Consumer consumer_of_(int);
 template<class T> NoToken consumer_of_(long);
 template<class T> using ConsumerOf = decltype(consumer_of_<T>(1));
 
+template<class Queue> using ElementOf = std::decay_t<decltype(std::declval<ConsumerOf<Queue>&>().pop(std::declval<Queue&>()))>;
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 template<class Queue, size_t Capacity>
@@ -55,6 +65,16 @@ struct CapacityArgAdaptor : Queue {
     {}
 };
 
+// Takes the capacity from the Context at run-time, so that one queue type is benchmarked with many capacities.
+template<class Queue>
+struct CapacityContextAdaptor : Queue {
+    using ContextType = Context;
+
+    ATOMIC_QUEUE_INLINE CapacityContextAdaptor(Context context)
+        : Queue(context.capacity)
+    {}
+};
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 template<class Queue>
@@ -78,6 +98,40 @@ struct RetryDecorator : Queue {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// The capabilities of a queue adaptor, which select the benchmarks and numbers of threads it runs with.
+enum QueueCapabilities : unsigned {
+    MPMC              = 0,
+    SPSC_ONLY         = 1, // 1 producer and 1 consumer only.
+    NEEDS_CONTEXT     = 2, // Constructed from a Context, see ContextOf.
+    TOKENS            = 4, // Uses producer and consumer tokens, see ProducerOf and ConsumerOf.
+    PER_PRODUCER_FIFO = 8  // FIFO per producer only, rather than one FIFO order of all producers.
+};
+
+template<class Queue>
+constexpr unsigned capabilities_of(unsigned capabilities = MPMC) noexcept {
+    return capabilities |
+        (std::is_same<ContextOf<Queue>, NoContext>::value ? 0u : unsigned{NEEDS_CONTEXT}) |
+        (std::is_same<ProducerOf<Queue>, NoToken>::value && std::is_same<ConsumerOf<Queue>, NoToken>::value ? 0u : unsigned{TOKENS});
+}
+
+// Queue adaptors register an Entry, the description of the adaptor for one kind of benchmarks, with a static object of
+// Registry<Entry>. Static objects of one translation unit are initialized in the order of their definitions, which is the order
+// of the entries.
+template<class Entry>
+struct Registry {
+    static std::vector<Entry>& entries() {
+        static std::vector<Entry> entries;
+        return entries;
+    }
+
+    template<class... Args>
+    explicit Registry(Args&&... args) {
+        entries().push_back(Entry{std::forward<Args>(args)...});
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 } // atomic_queue
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
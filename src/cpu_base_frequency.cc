@@ -14,10 +14,21 @@
 #include <string>
 #include <thread>
 #include <system_error>
+#include <memory>
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
 
 #include <pthread.h>
 #include <dlfcn.h>
+#include <dirent.h>
 #include <sched.h>
+#include <time.h>
 
 using namespace atomic_queue;
 
@@ -39,18 +50,137 @@ struct CpuSet : cpu_set_t {
     }
 };
 
+// Parses a sysfs CPU list, such as 0-7,16-23.
+std::vector<unsigned> parse_cpu_list(std::string const& list) {
+    std::vector<unsigned> cpus;
+    for(char const* p = list.c_str();;) {
+        char* end;
+        unsigned const first = std::strtoul(p, &end, 10);
+        if(end == p)
+            break;
+        unsigned last = first;
+        if(*end == '-')
+            last = std::strtoul(end + 1, &end, 10);
+        for(unsigned cpu = first; cpu <= last; ++cpu)
+            cpus.push_back(cpu);
+        if(*end != ',')
+            break;
+        p = end + 1;
+    }
+    return cpus;
+}
+
+struct CacheIds {
+    unsigned l2;
+    unsigned llc;
+};
+
+// The lowest hw_thread_ids sharing the L2 and the highest level data or unified caches with hw_thread_id, from
+// /sys/devices/system/cpu/cpu*/cache. hw_thread_id itself, when the kernel doesn't report the caches.
+CacheIds cache_ids(unsigned hw_thread_id) {
+    CacheIds ids{hw_thread_id, hw_thread_id};
+    unsigned max_level = 0;
+    std::string const cpu_dir = "/sys/devices/system/cpu/cpu" + std::to_string(hw_thread_id) + "/cache/index";
+    for(unsigned index = 0;; ++index) {
+        std::string const dir = cpu_dir + std::to_string(index) + '/';
+        std::ifstream level_file(dir + "level");
+        unsigned level;
+        if(!(level_file >> level))
+            break;
+        std::ifstream type_file(dir + "type");
+        std::ifstream shared_file(dir + "shared_cpu_list");
+        std::string type;
+        std::string shared;
+        if(!(type_file >> type && type != "Instruction" && shared_file >> shared))
+            continue;
+        auto const shared_cpus = parse_cpu_list(shared);
+        if(shared_cpus.empty())
+            continue;
+        if(level == 2)
+            ids.l2 = shared_cpus[0];
+        if(level > max_level) {
+            max_level = level;
+            ids.llc = shared_cpus[0];
+        }
+    }
+    return ids;
+}
+
+// The NUMA node of each hw_thread_id, from /sys/devices/system/node/node*/cpulist. Empty without NUMA support.
+std::vector<unsigned> numa_nodes() {
+    std::vector<unsigned> nodes;
+    std::unique_ptr<DIR, int(*)(DIR*)> dir{::opendir("/sys/devices/system/node"), ::closedir};
+    if(!dir)
+        return nodes;
+    while(dirent const* entry = ::readdir(dir.get())) {
+        unsigned node;
+        char c;
+        if(std::sscanf(entry->d_name, "node%u%c", &node, &c) != 1)
+            continue;
+        std::ifstream cpulist_file(std::string("/sys/devices/system/node/") + entry->d_name + "/cpulist");
+        std::string cpulist;
+        if(!(cpulist_file >> cpulist))
+            continue;
+        for(unsigned cpu : parse_cpu_list(cpulist)) {
+            if(nodes.size() <= cpu)
+                nodes.resize(cpu + 1);
+            nodes[cpu] = node;
+        }
+    }
+    return nodes;
+}
+
 } // namespace
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-double atomic_queue::cpu_base_frequency() {
-    std::regex const re("model name\\s*:[^@]+@\\s*([0-9.]+)\\s*GHz");
+TscFrequency atomic_queue::tsc_frequency() {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned eax, ebx, ecx, edx;
+    if(!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1u << 8)))
+        std::fprintf(stderr, "Warning: the time stamp counter is not invariant, its frequency may change with the CPU frequency and "
+                     "stop in deep C-states. The times are unreliable.\n");
+
+    unsigned const max_leaf = __get_cpuid_max(0, nullptr);
+    // The TSC to core crystal clock ratio ebx/eax and the crystal clock frequency ecx, Intel Skylake and later.
+    if(max_leaf >= 0x15 && __get_cpuid(0x15, &eax, &ebx, &ecx, &edx) && eax && ebx && ecx)
+        return {static_cast<double>(ecx) * ebx / eax * 1e-9, "CPUID leaf 0x15"};
+
+    // The kernel's tsc_khz, which some kernels expose.
+    unsigned long long tsc_khz = 0;
+    if(std::ifstream("/sys/devices/system/cpu/cpu0/tsc_freq_khz") >> tsc_khz && tsc_khz)
+        return {tsc_khz * 1e-6, "tsc_freq_khz"};
+
+    // The processor base frequency in MHz, at which the invariant TSC of Intel CPUs runs.
+    if(max_leaf >= 0x16 && __get_cpuid(0x16, &eax, &ebx, &ecx, &edx) && (eax & 0xffff))
+        return {(eax & 0xffff) * 1e-3, "CPUID leaf 0x16"};
+
+    // Count the TSC ticks over an interval of CLOCK_MONOTONIC_RAW, which isn't subject to NTP adjustments. Each clock reading is
+    // bracketed by two TSC readings to halve the error of the time clock_gettime takes.
+    auto sample = []() {
+        timespec t;
+        unsigned long long const tsc0 = __rdtsc();
+        ::clock_gettime(CLOCK_MONOTONIC_RAW, &t);
+        unsigned long long const tsc1 = __rdtsc();
+        return std::make_pair(t.tv_sec * 1e9 + t.tv_nsec, (tsc0 + tsc1) * .5);
+    };
+    auto const start = sample();
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    auto const end = sample();
+    return {(end.second - start.second) / (end.first - start.first), "calibration against CLOCK_MONOTONIC_RAW"};
+#else
+    return {1, "none, reporting cycles"};
+#endif
+}
+
+std::string atomic_queue::cpu_model_name() {
+    std::regex const re("model name\\s*:\\s*(.*)");
     std::ifstream cpuinfo("/proc/cpuinfo");
     std::smatch m;
     for(std::string line; getline(cpuinfo, line);)
         if(regex_match(line, m, re))
-            return std::stod(m[1]);
-    return 1; // Fallback to cycles, should it fail to parse.
+            return m[1];
+    return {};
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -73,7 +203,7 @@ std::vector<atomic_queue::CpuTopologyInfo> atomic_queue::get_cpu_topology_info()
 
     std::ifstream cpuinfo("/proc/cpuinfo");
     std::smatch m;
-    CpuTopologyInfo element;
+    CpuTopologyInfo element = {};
     unsigned valid_members = 0;
     for(std::string line; getline(cpuinfo, line);) {
         for(unsigned i = 0, mask = 1; i < M; ++i, mask <<= 1) {
@@ -92,6 +222,14 @@ std::vector<atomic_queue::CpuTopologyInfo> atomic_queue::get_cpu_topology_info()
     if(std::thread::hardware_concurrency() != cpus.size())
         throw std::runtime_error("get_cpu_topology_info() invariant broken.");
 
+    auto const nodes = numa_nodes();
+    for(auto& cpu : cpus) {
+        auto const ids = cache_ids(cpu.hw_thread_id);
+        cpu.l2_id = ids.l2;
+        cpu.llc_id = ids.llc;
+        cpu.node_id = cpu.hw_thread_id < nodes.size() ? nodes[cpu.hw_thread_id] : 0;
+    }
+
     return sort_by_hw_thread_id(cpus);
 }
 
@@ -123,6 +261,33 @@ std::vector<atomic_queue::CpuTopologyInfo> atomic_queue::sort_by_hw_thread_id(st
     return u;
 }
 
+std::vector<atomic_queue::CpuTopologyInfo> atomic_queue::sort_by_llc_id(std::vector<atomic_queue::CpuTopologyInfo> const& v) {
+    // Within a last-level cache, the first hardware threads of all cores precede the second ones, so that consecutive CPUs
+    // belong to different cores.
+    auto const by_core = sort_by_core_id(v);
+    std::vector<std::pair<unsigned, CpuTopologyInfo>> u; // The index of the hardware thread in its core and the CPU.
+    for(auto& cpu : by_core) {
+        bool const sibling = !u.empty() && u.back().second.socket_id == cpu.socket_id && u.back().second.core_id == cpu.core_id;
+        u.emplace_back(sibling ? u.back().first + 1 : 0, cpu);
+    }
+    std::sort(u.begin(), u.end(), [](auto& a, auto& b) {
+        return std::tie(a.second.node_id, a.second.socket_id, a.second.llc_id, a.first, a.second.hw_thread_id) <
+               std::tie(b.second.node_id, b.second.socket_id, b.second.llc_id, b.first, b.second.hw_thread_id);
+    });
+    std::vector<CpuTopologyInfo> w;
+    for(auto& cpu : u)
+        w.push_back(cpu.second);
+    return w;
+}
+
+unsigned atomic_queue::count_llcs(std::vector<atomic_queue::CpuTopologyInfo> const& v) {
+    std::vector<unsigned> llcs;
+    for(auto& cpu : v)
+        if(std::find(llcs.begin(), llcs.end(), cpu.llc_id) == llcs.end())
+            llcs.push_back(cpu.llc_id);
+    return llcs.size();
+}
+
 std::vector<unsigned> atomic_queue::hw_thread_id(std::vector<atomic_queue::CpuTopologyInfo> const& v) {
     std::vector<unsigned> u(v.size());
     for(unsigned i = 0, j = u.size(); i < j; ++i)
@@ -155,6 +320,7 @@ void set_thread_affinity_(cpu_set_t const& cpuset) {
 }
 
 int default_thread_affinity = -1;
+CpuSet const initial_thread_affinity = CpuSet::get_default(); // Of the main thread before it gets pinned: the CPUs available to the process.
 auto const real_pthread_create = reinterpret_cast<decltype(&pthread_create)>(::dlsym(RTLD_NEXT, "pthread_create"));
 
 } // namespace
@@ -168,18 +334,18 @@ void atomic_queue::set_thread_affinity(unsigned hw_thread_id) {
     set_thread_affinity_(cpuset);
 }
 
-// void atomic_queue::reset_thread_affinity() {
-//     cpu_set_t cpuset;
-//     CPU_ZERO(&cpuset);
-//     for(unsigned i = 0, j = std::thread::hardware_concurrency(); i < j; ++i)
-//         CPU_SET(i, &cpuset);
-//     set_thread_affinity_(cpuset);
-// }
+void atomic_queue::reset_thread_affinity() {
+    set_thread_affinity_(initial_thread_affinity);
+}
 
 void atomic_queue::set_default_thread_affinity(unsigned hw_thread_id) {
     default_thread_affinity = hw_thread_id;
 }
 
+void atomic_queue::reset_default_thread_affinity() {
+    default_thread_affinity = -1;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 int pthread_create(pthread_t* newthread,
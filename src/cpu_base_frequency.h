@@ -4,6 +4,7 @@
 
 // Copyright (c) 2019 Maxim Egorushkin. MIT License. See the full licence in file LICENSE.
 
+#include <string>
 #include <vector>
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -12,7 +13,13 @@ namespace atomic_queue {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-double cpu_base_frequency();
+struct TscFrequency {
+    double ghz;
+    char const* source; // How the frequency was found.
+};
+// The time stamp counter frequency, from CPUID, the kernel, or measured. Warns when the time stamp counter isn't invariant.
+TscFrequency tsc_frequency();
+std::string cpu_model_name();
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -20,12 +27,19 @@ struct CpuTopologyInfo {
     unsigned socket_id;
     unsigned core_id;
     unsigned hw_thread_id;
+    unsigned l2_id;   // The lowest hw_thread_id sharing the L2 cache with this one.
+    unsigned llc_id;  // The lowest hw_thread_id sharing the last-level cache with this one, e.g. the L3 of one AMD CCX.
+    unsigned node_id; // The NUMA node, 0 without NUMA.
 };
 std::vector<CpuTopologyInfo> get_cpu_topology_info();
 std::vector<CpuTopologyInfo> get_available_cpu_topology_info();
 
 std::vector<CpuTopologyInfo> sort_by_core_id(std::vector<CpuTopologyInfo> const&);
 std::vector<CpuTopologyInfo> sort_by_hw_thread_id(std::vector<CpuTopologyInfo> const&);
+// Groups the CPUs by the NUMA node and the last-level cache. Each consecutive pair of CPUs shares the last-level cache, but not
+// a core, when the cache is shared by more than one core. For placing producer and consumer pairs.
+std::vector<CpuTopologyInfo> sort_by_llc_id(std::vector<CpuTopologyInfo> const&);
+unsigned count_llcs(std::vector<CpuTopologyInfo> const&);
 
 std::vector<unsigned> hw_thread_id(std::vector<CpuTopologyInfo> const&);
 
@@ -34,9 +48,10 @@ void log_cpus(std::vector<CpuTopologyInfo> const&) noexcept;
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void set_thread_affinity(unsigned hw_thread_id);
-// void reset_thread_affinity();
+void reset_thread_affinity(); // Allows the calling thread to run on any CPU available to the process.
 
 void set_default_thread_affinity(unsigned hw_thread_id);
+void reset_default_thread_affinity(); // New threads inherit the affinity of the thread creating them.
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -0,0 +1,120 @@
+/* -*- mode: c++; c-basic-offset: 4; indent-tabs-mode: nil; tab-width: 4 -*- */
+#ifndef JSON_WRITER_H_INCLUDED
+#define JSON_WRITER_H_INCLUDED
+
+// Copyright (c) 2019 Maxim Egorushkin. MIT License. See the full licence in file LICENSE.
+
+#include <cstdio>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace atomic_queue {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// A minimal JSON writer for benchmark reports. Produces one line of compact JSON, so that multiple documents can be appended
+// to one file as JSON Lines. The caller is responsible for balancing the objects and arrays and for calling key() before
+// each object member.
+//
+// There are no floating-point values, because printf formats them with the locale decimal point, which the benchmarks
+// enable for the thousand separators. Report integer cycles and Hz instead.
+class JsonWriter {
+    std::string& s_;
+    bool comma_ = false; // Whether the next value or key follows another one.
+
+    void separate() {
+        if(comma_)
+            s_ += ',';
+        comma_ = false;
+    }
+
+    void string(char const* value) {
+        s_ += '"';
+        for(unsigned char c; (c = *value); ++value) {
+            switch(c) {
+            case '"':  s_ += "\\\""; break;
+            case '\\': s_ += "\\\\"; break;
+            case '\n': s_ += "\\n"; break;
+            case '\t': s_ += "\\t"; break;
+            default:
+                if(c < 0x20) {
+                    char u[7];
+                    std::snprintf(u, sizeof u, "\\u%04x", c);
+                    s_ += u;
+                } else {
+                    s_ += static_cast<char>(c);
+                }
+            }
+        }
+        s_ += '"';
+    }
+
+    JsonWriter& scalar(char const* value) {
+        separate();
+        s_ += value;
+        comma_ = true;
+        return *this;
+    }
+
+public:
+    explicit JsonWriter(std::string& s) noexcept
+        : s_(s)
+    {}
+
+    JsonWriter& begin_object() { separate(); s_ += '{'; return *this; }
+    JsonWriter& end_object() { s_ += '}'; comma_ = true; return *this; }
+    JsonWriter& begin_array() { separate(); s_ += '['; return *this; }
+    JsonWriter& end_array() { s_ += ']'; comma_ = true; return *this; }
+
+    JsonWriter& key(char const* name) {
+        separate();
+        string(name);
+        s_ += ':';
+        return *this;
+    }
+
+    JsonWriter& value(char const* value) {
+        separate();
+        string(value);
+        comma_ = true;
+        return *this;
+    }
+
+    JsonWriter& value(std::string const& value) {
+        return this->value(value.c_str());
+    }
+
+    JsonWriter& value(bool value) {
+        return scalar(value ? "true" : "false");
+    }
+
+    JsonWriter& value(unsigned long long value) {
+        char buf[24];
+        std::snprintf(buf, sizeof buf, "%llu", value);
+        return scalar(buf);
+    }
+
+    JsonWriter& value(unsigned value) {
+        return this->value(static_cast<unsigned long long>(value));
+    }
+
+    JsonWriter& value(int value) {
+        char buf[16];
+        std::snprintf(buf, sizeof buf, "%d", value);
+        return scalar(buf);
+    }
+
+    template<class T>
+    JsonWriter& member(char const* name, T const& value) {
+        return key(name).value(value);
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace atomic_queue
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // JSON_WRITER_H_INCLUDED
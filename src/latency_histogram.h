@@ -0,0 +1,87 @@
+/* -*- mode: c++; c-basic-offset: 4; indent-tabs-mode: nil; tab-width: 4 -*- */
+#ifndef LATENCY_HISTOGRAM_H_INCLUDED
+#define LATENCY_HISTOGRAM_H_INCLUDED
+
+// Copyright (c) 2019 Maxim Egorushkin. MIT License. See the full licence in file LICENSE.
+
+#include "atomic_queue/defs.h"
+
+#include <cmath>
+#include <cstdint>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace atomic_queue {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// A log-linear histogram of 32-bit values, such as latencies in CPU cycles, in the style of HdrHistogram.
+//
+// Values less than 2^SUB_BITS are recorded exactly. Larger values are recorded into 2^(SUB_BITS-1) linear sub-buckets of each
+// power-of-2 range, which bounds the relative error of the reported values by 2^(1-SUB_BITS), i.e. by 1/128 for 8 bits.
+// Recording a value is a few instructions and no branches, so that each thread can record into its own histogram in the hot
+// path. The histograms of different threads and runs are merged afterwards.
+class alignas(CACHE_LINE_SIZE) LatencyHistogram {
+public:
+    using value_type = std::uint32_t;
+    static constexpr unsigned SUB_BITS = 8;
+
+private:
+    static constexpr unsigned HALF = 1u << (SUB_BITS - 1);
+    static constexpr unsigned N_BUCKETS = (sizeof(value_type) * 8 + 2 - SUB_BITS) * HALF;
+
+    std::uint64_t counts_[N_BUCKETS] = {};
+    std::uint64_t total_ = 0;
+    value_type max_ = 0;
+
+    ATOMIC_QUEUE_SINLINE unsigned shift_of(value_type value) noexcept {
+        value_type const hi = value >> SUB_BITS;
+        return hi ? sizeof(unsigned) * 8 - __builtin_clz(hi) : 0;
+    }
+
+    ATOMIC_QUEUE_SINLINE unsigned bucket_of(value_type value) noexcept {
+        unsigned const shift = shift_of(value);
+        return shift * HALF + (value >> shift);
+    }
+
+    // The highest value recorded into a bucket.
+    ATOMIC_QUEUE_SINLINE value_type highest_of(unsigned bucket) noexcept {
+        unsigned const shift = bucket < 2 * HALF ? 0 : bucket / HALF - 1;
+        return ((static_cast<std::uint64_t>(bucket - shift * HALF) + 1) << shift) - 1;
+    }
+
+public:
+    ATOMIC_QUEUE_INLINE void record(value_type value) noexcept {
+        ++counts_[bucket_of(value)];
+        ++total_;
+        max_ = max_value(max_, value);
+    }
+
+    void merge(LatencyHistogram const& b) noexcept {
+        for(unsigned i = 0; i < N_BUCKETS; ++i)
+            counts_[i] += b.counts_[i];
+        total_ += b.total_;
+        max_ = max_value(max_, b.max_);
+    }
+
+    // The value at or below which the fraction p of the recorded values are, rounded up to the bucket boundary.
+    value_type percentile(double p) const noexcept {
+        std::uint64_t const rank = max_value(static_cast<std::uint64_t>(std::ceil(p * total_)), std::uint64_t{1});
+        std::uint64_t count = 0;
+        for(unsigned i = 0; i < N_BUCKETS; ++i)
+            if((count += counts_[i]) >= rank)
+                return min_value(highest_of(i), max_);
+        return max_;
+    }
+
+    std::uint64_t total() const noexcept { return total_; }
+    value_type max() const noexcept { return max_; }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace atomic_queue
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // LATENCY_HISTOGRAM_H_INCLUDED
@@ -0,0 +1,123 @@
+/* -*- mode: c++; c-basic-offset: 4; indent-tabs-mode: nil; tab-width: 4 -*- */
+
+// Copyright (c) 2019 Maxim Egorushkin. MIT License. See the full licence in file LICENSE.
+
+#include "perf_counters.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace atomic_queue;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct EventConfig {
+    std::uint32_t type;
+    std::uint64_t config;
+};
+
+EventConfig const events[PerfCounters::N_EVENTS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+};
+
+int open_event(unsigned event, int group_fd) noexcept {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof attr);
+    attr.size = sizeof attr;
+    attr.type = events[event].type;
+    attr.config = events[event].config;
+    attr.disabled = group_fd < 0; // The group members are enabled and disabled by the group leader.
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return ::syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC); // This thread on any CPU.
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+char const* const PerfCounters::event_names[N_EVENTS] = {"cycles", "instructions", "branch misses", "L1D read misses", "LLC misses"};
+
+unsigned PerfCounters::supported_ = 0;
+
+bool PerfCounters::init() noexcept {
+    supported_ = 0;
+    for(unsigned event = 0; event < N_EVENTS; ++event) {
+        int const fd = open_event(event, -1);
+        if(fd < 0) {
+            if(event == CYCLES) { // The group leader.
+                std::fprintf(stderr, "Warning: perf_event_open failed: %s. Hardware performance counters are disabled. "
+                             "Check /proc/sys/kernel/perf_event_paranoid and whether the virtual machine exposes a PMU.\n", std::strerror(errno));
+                return false;
+            }
+            continue;
+        }
+        ::close(fd);
+        supported_ |= 1u << event;
+    }
+    return true;
+}
+
+PerfCounters::PerfCounters(bool enable) noexcept {
+    int group_fd = -1;
+    for(unsigned event = 0; event < N_EVENTS; ++event) {
+        fds_[event] = enable && supported(event) ? open_event(event, group_fd) : -1;
+        if(event == CYCLES)
+            group_fd = fds_[event];
+        if(group_fd < 0) // No counters without the group leader.
+            enable = false;
+    }
+}
+
+PerfCounters::~PerfCounters() noexcept {
+    for(int fd : fds_)
+        if(fd >= 0)
+            ::close(fd);
+}
+
+void PerfCounters::start() noexcept {
+    if(fds_[CYCLES] >= 0) {
+        ::ioctl(fds_[CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ::ioctl(fds_[CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+void PerfCounters::stop() noexcept {
+    if(fds_[CYCLES] >= 0)
+        ::ioctl(fds_[CYCLES], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void PerfCounters::read(std::uint64_t (&counts)[N_EVENTS]) const noexcept {
+    for(auto& count : counts)
+        count = 0;
+
+    struct {
+        std::uint64_t nr;
+        std::uint64_t time_enabled;
+        std::uint64_t time_running;
+        std::uint64_t values[N_EVENTS];
+    } group;
+    if(fds_[CYCLES] < 0 || ::read(fds_[CYCLES], &group, sizeof group) <= 0 || !group.time_running)
+        return;
+
+    // The values are in the order the events were added to the group.
+    double const scale = static_cast<double>(group.time_enabled) / group.time_running;
+    for(unsigned event = 0, i = 0; event < N_EVENTS && i < group.nr; ++event)
+        if(fds_[event] >= 0)
+            counts[event] = static_cast<std::uint64_t>(group.values[i++] * scale);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
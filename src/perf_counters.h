@@ -0,0 +1,58 @@
+/* -*- mode: c++; c-basic-offset: 4; indent-tabs-mode: nil; tab-width: 4 -*- */
+#ifndef PERF_COUNTERS_H_INCLUDED
+#define PERF_COUNTERS_H_INCLUDED
+
+// Copyright (c) 2019 Maxim Egorushkin. MIT License. See the full licence in file LICENSE.
+
+#include <cstdint>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace atomic_queue {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The hardware performance counters of the calling thread, using Linux perf_event_open.
+//
+// The events are opened as one group, so that they are counted over the same time intervals. Only user-space events are
+// counted, which perf_event_paranoid 2, the default, permits. Events the CPU doesn't support are skipped.
+class PerfCounters {
+public:
+    enum Event { CYCLES, INSTRUCTIONS, BRANCH_MISSES, L1D_READ_MISSES, LLC_MISSES, N_EVENTS };
+    static char const* const event_names[N_EVENTS];
+
+private:
+    static unsigned supported_; // The bit-mask of the events which can be opened.
+
+    int fds_[N_EVENTS]; // fds_[CYCLES] is the group leader. -1 for the events which are not counted.
+
+public:
+    // Finds out which events can be counted. Prints a warning and returns false when the counters are unavailable, e.g. when
+    // perf_event_paranoid forbids access or in a virtual machine without a virtual PMU.
+    static bool init() noexcept;
+
+    static bool supported(unsigned event) noexcept {
+        return supported_ & (1u << event);
+    }
+
+    // Opens the disabled counters of the calling thread, unless enable is false.
+    explicit PerfCounters(bool enable) noexcept;
+    ~PerfCounters() noexcept;
+
+    PerfCounters(PerfCounters const&) = delete;
+    PerfCounters& operator=(PerfCounters const&) = delete;
+
+    void start() noexcept; // Resets and enables the counters.
+    void stop() noexcept;
+
+    // Stores the counts since start(), scaled up when the counters were multiplexed, 0 for the events not counted.
+    void read(std::uint64_t (&counts)[N_EVENTS]) const noexcept;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace atomic_queue
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // PERF_COUNTERS_H_INCLUDED
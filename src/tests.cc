@@ -7,7 +7,11 @@
 
 #include "atomic_queue/atomic_queue.h"
 #include "atomic_queue/barrier.h"
+#include "atomic_queue/latest_value.h"
+#include "atomic_queue/overwrite_queue.h"
 #include "benchmarks.h"
+#include "json_writer.h"
+#include "latency_histogram.h"
 
 #include <boost/mpl/list.hpp>
 #include <bitset>
@@ -97,6 +101,40 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(stress, Queue, stress_queues) {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+using tree_barriers = boost::mpl::list<
+    TreeBarrier<8, 2>, // 3 levels for 7 threads.
+    TreeBarrier<8, 4>,
+    TreeBarrier<8, 8>  // The root node only.
+>;
+
+// Check that no thread leaves the barrier before all threads have arrived, and that the barrier is reusable.
+BOOST_AUTO_TEST_CASE_TEMPLATE(tree_barrier, Barrier, tree_barriers) {
+    enum { THREADS = 7, EPISODES = 100 };
+
+    Barrier barrier(THREADS);
+    std::atomic<unsigned> arrived{0};
+    std::atomic<unsigned> released{0};
+    std::atomic<unsigned> errors{0};
+
+    std::thread threads[THREADS];
+    for(auto& t : threads)
+        t = std::thread([&, thread_idx = static_cast<unsigned>(&t - threads)]() {
+            for(unsigned episode = 1; episode <= EPISODES; ++episode) {
+                arrived.fetch_add(1);
+                released += barrier.wait(thread_idx);
+                errors += arrived.load() < episode * THREADS;
+            }
+        });
+    for(auto& t : threads)
+        t.join();
+
+    BOOST_CHECK_EQUAL(errors.load(), 0u);
+    BOOST_CHECK_EQUAL(arrived.load(), THREADS * EPISODES);
+    BOOST_CHECK_EQUAL(released.load(), EPISODES); // One thread releases the barrier in each episode.
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 namespace {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -298,6 +336,92 @@ BOOST_AUTO_TEST_CASE(size) {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+BOOST_AUTO_TEST_CASE(latency_histogram) {
+    LatencyHistogram h, h2;
+    BOOST_CHECK_EQUAL(h.total(), 0u);
+    BOOST_CHECK_EQUAL(h.percentile(.5), 0u);
+
+    for(unsigned i = 1; i <= 100; ++i)
+        h.record(i);
+    BOOST_CHECK_EQUAL(h.percentile(.5), 50u); // Small values are exact.
+    BOOST_CHECK_EQUAL(h.percentile(.99), 99u);
+    BOOST_CHECK_EQUAL(h.percentile(1), 100u);
+
+    for(unsigned i = 1; i <= 1000000; ++i)
+        h2.record(i * 1000u);
+    h2.record(~0u);
+    BOOST_CHECK_EQUAL(h2.max(), ~0u);
+    for(double p : {.5, .9, .99, .999, .9999}) {
+        double const expected = p * 1e9;
+        BOOST_CHECK_GE(h2.percentile(p), expected); // Rounded up to the bucket boundary.
+        BOOST_CHECK_LE(h2.percentile(p), expected * (1 + 1. / 128) + 1000);
+    }
+    BOOST_CHECK_EQUAL(h2.percentile(1), ~0u);
+
+    h.merge(h2);
+    BOOST_CHECK_EQUAL(h.total(), 1000101u);
+    BOOST_CHECK_EQUAL(h.max(), ~0u);
+    BOOST_CHECK_EQUAL(h.percentile(.5), h2.percentile(.5 - 50. / 1000101));
+}
+
+BOOST_AUTO_TEST_CASE(json_writer) {
+    std::string s;
+    JsonWriter j(s);
+    j.begin_object();
+    j.member("name", "a\"b\\c\n\x01").member("n", 18446744073709551615ull).member("i", -1).member("b", true);
+    j.key("a").begin_array().value(1u).value(2u).begin_object().end_object().begin_array().end_array().end_array();
+    j.key("o").begin_object().member("x", 0u).end_object();
+    j.end_object();
+    BOOST_CHECK_EQUAL(s, R"({"name":"a\"b\\c\n\u0001","n":18446744073709551615,"i":-1,"b":true,"a":[1,2,{},[]],"o":{"x":0}})");
+}
+
+template<unsigned N> struct StatsTag {}; // Count the statistics of each queue separately.
+
+using stats_queues = boost::mpl::list<
+    AtomicQueue<unsigned, 4, 0u, true, true, false, false, Stats<StatsTag<0>>>,
+    AtomicQueue2<unsigned, 4, true, true, false, true, Stats<StatsTag<1>>>,
+    CapacityArgAdaptor<AtomicQueueB<unsigned, std::allocator<unsigned>, 0u, true, false, true, Stats<StatsTag<2>>>, 4>,
+    CapacityArgAdaptor<AtomicQueueB2<unsigned, std::allocator<unsigned>, true, false, false, Stats<StatsTag<3>>>, 4>
+>;
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(stats, Queue, stats_queues) {
+    Queue q;
+    unsigned const capacity = q.capacity();
+    unsigned e = 0;
+    BOOST_CHECK(!q.try_pop(e));
+    for(unsigned i = 1; i <= capacity; ++i)
+        BOOST_CHECK(q.try_push(i));
+    BOOST_CHECK(!q.try_push(capacity + 1));
+    for(unsigned i = 1; i <= capacity; ++i) {
+        BOOST_CHECK(q.try_pop(e));
+        BOOST_CHECK_EQUAL(e, i);
+    }
+
+    StatsSnapshot s = q.stats();
+    BOOST_CHECK_EQUAL(s.try_pop_failures, 1u);
+    BOOST_CHECK_EQUAL(s.try_push_failures, 1u);
+    BOOST_CHECK_EQUAL(s.max_size, capacity);
+    BOOST_CHECK_EQUAL(s.push_cas_failures, 0u); // Single-threaded.
+    BOOST_CHECK_EQUAL(s.pop_cas_failures, 0u);
+    BOOST_CHECK_EQUAL(s.push_spins, 0u);
+    BOOST_CHECK_EQUAL(s.pop_spins, 0u);
+
+    // pop blocks on an empty queue and spins until an element is pushed.
+    std::thread consumer([&q, &e]() { e = q.pop(); });
+    while(!q.stats().pop_spins)
+        std::this_thread::yield();
+    q.push(capacity + 2);
+    consumer.join();
+    BOOST_CHECK_EQUAL(e, capacity + 2);
+    BOOST_CHECK_GT(q.stats().pop_spins, 0u);
+
+    Queue::stats_type::reset();
+    s = q.stats();
+    BOOST_CHECK_EQUAL(s.try_pop_failures + s.try_push_failures + s.pop_spins + s.max_size, 0u);
+
+    BOOST_CHECK_EQUAL((AtomicQueue<unsigned, 4>{}.stats().max_size), 0u); // NoStats counts nothing.
+}
+
 BOOST_AUTO_TEST_CASE(power_of_2) {
     using atomic_queue::details::round_up_to_power_of_2;
     static_assert(round_up_to_power_of_2(0u) == 0u, "");
@@ -381,3 +505,176 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(remap_index, Remap, remap_index_fns) {
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+using overwrite_queues = boost::mpl::list<
+    OverwriteQueue<unsigned, 64, true>,
+    OverwriteQueue<unsigned, 64, false>
+>;
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(overwrite_queue, Queue, overwrite_queues) {
+    Queue q;
+    unsigned constexpr C = Queue::capacity();
+    BOOST_CHECK_EQUAL(C, 64u);
+    BOOST_CHECK(q.was_empty());
+
+    unsigned v = 0;
+    BOOST_CHECK(!q.try_pop(v));
+
+    // FIFO when not full.
+    for(unsigned i = 1; i <= C; ++i)
+        q.push(i);
+    BOOST_CHECK_EQUAL(q.was_size(), C);
+    for(unsigned i = 1; i <= C; ++i) {
+        BOOST_REQUIRE(q.try_pop(v));
+        BOOST_CHECK_EQUAL(v, i);
+    }
+    BOOST_CHECK(!q.try_pop(v));
+    BOOST_CHECK_EQUAL(q.dropped(), 0u);
+
+    // Push overwrites the oldest messages when full, the consumer skips the overwritten messages.
+    unsigned constexpr OVERWRITTEN = 10;
+    for(unsigned i = 1; i <= C + OVERWRITTEN; ++i)
+        q.push(i);
+    BOOST_CHECK_EQUAL(q.was_size(), C);
+    for(unsigned i = OVERWRITTEN + 1; i <= C + OVERWRITTEN; ++i) {
+        BOOST_REQUIRE(q.try_pop(v));
+        BOOST_CHECK_EQUAL(v, i);
+    }
+    BOOST_CHECK(!q.try_pop(v));
+    BOOST_CHECK(q.was_empty());
+    BOOST_CHECK_EQUAL(q.dropped(), OVERWRITTEN);
+}
+
+// Check that the consumer never receives torn messages or messages out of order, and that each message is either received
+// or counted as dropped, with multiple producers overwriting the messages.
+BOOST_AUTO_TEST_CASE(overwrite_queue_stress) {
+    enum { PRODUCERS = 3, N_MSG = 100000 };
+
+    struct Message {
+        uint64_t words[4]; // Spans multiple words of SeqlockStorage.
+    };
+    OverwriteQueue<Message, 256, false> q;
+    std::atomic<bool> producers_done{false};
+    Barrier2 barrier = {{PRODUCERS + 1}};
+
+    std::thread producers[PRODUCERS];
+    for(auto& producer : producers)
+        producer = std::thread([&q, &barrier, producer_idx = static_cast<uint64_t>(&producer - producers)]() {
+            barrier.countdown();
+            for(uint64_t n = 1; n <= N_MSG; ++n) {
+                uint64_t const w = producer_idx << 32 | n;
+                q.push(Message{{w, w, w, w}});
+            }
+        });
+
+    uint64_t received = 0, torn = 0, reordered = 0;
+    std::thread consumer([&]() {
+        barrier.countdown();
+        uint64_t last[PRODUCERS] = {};
+        for(bool done = false;;) {
+            Message m;
+            if(!q.try_pop(m)) {
+                if(done)
+                    break;
+                done = producers_done.load(); // Drain the queue once more after the producers have finished.
+                continue;
+            }
+            ++received;
+            torn += m.words[0] != m.words[1] || m.words[0] != m.words[2] || m.words[0] != m.words[3];
+            auto& l = last[(m.words[0] >> 32) % PRODUCERS];
+            reordered += (m.words[0] & 0xffffffff) <= l;
+            l = m.words[0] & 0xffffffff;
+        }
+    });
+
+    for(auto& t : producers)
+        t.join();
+    producers_done.store(true);
+    consumer.join();
+
+    BOOST_CHECK_EQUAL(torn, 0u);
+    BOOST_CHECK_EQUAL(reordered, 0u);
+    BOOST_CHECK_EQUAL(received + q.dropped(), PRODUCERS * N_MSG);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE(latest_value_table) {
+    LatestValueTable<unsigned, 4> t;
+    BOOST_CHECK_EQUAL(t.size(), 4u);
+    for(unsigned key = 0; key < t.size(); ++key) {
+        BOOST_CHECK_EQUAL(t.load(key), 0u); // Zero-initialized.
+        BOOST_CHECK_EQUAL(t.version(key), 0u);
+    }
+
+    t.store(1, 10);
+    t.store(1, 11);
+    t.store(2, 20);
+    BOOST_CHECK_EQUAL(t.load(0), 0u);
+    BOOST_CHECK_EQUAL(t.load(1), 11u);
+    BOOST_CHECK_EQUAL(t.load(2), 20u);
+    BOOST_CHECK_EQUAL(t.version(0), 0u);
+    BOOST_CHECK_EQUAL(t.version(1), 2u);
+    BOOST_CHECK_EQUAL(t.version(2), 1u);
+
+    unsigned v = 0;
+    BOOST_CHECK(t.try_load(2, v));
+    BOOST_CHECK_EQUAL(v, 20u);
+    BOOST_CHECK_EQUAL(sizeof t, 4 * CACHE_LINE_SIZE); // One cache line per cell.
+}
+
+using latest_value_writers = boost::mpl::list<
+    std::integral_constant<bool, true>,
+    std::integral_constant<bool, false>
+>;
+
+// Check that readers never load torn values and never observe values going backwards.
+BOOST_AUTO_TEST_CASE_TEMPLATE(latest_value_stress, SingleWriter, latest_value_writers) {
+    enum { WRITERS = SingleWriter::value ? 1 : 2, READERS = 2, N_MSG = 100000 };
+
+    struct Value {
+        uint64_t words[4]; // Spans multiple words of SeqlockStorage.
+    };
+    LatestValue<Value, SingleWriter::value> cell;
+    std::atomic<unsigned> writers_done{0};
+    Barrier2 barrier = {{WRITERS + READERS}};
+
+    std::thread writers[WRITERS];
+    for(auto& writer : writers)
+        writer = std::thread([&]() {
+            barrier.countdown();
+            for(uint64_t n = 1; n <= N_MSG; ++n)
+                cell.store(Value{{n, n, n, n}});
+            ++writers_done;
+        });
+
+    std::atomic<unsigned> torn{0}, backwards{0};
+    std::thread readers[READERS];
+    for(auto& reader : readers)
+        reader = std::thread([&]() {
+            barrier.countdown();
+            uint64_t last = 0;
+            unsigned last_version = 0;
+            for(bool done = false; !done;) {
+                done = writers_done.load() == WRITERS;
+                unsigned const version = cell.version();
+                Value const v = cell.load();
+                torn += v.words[0] != v.words[1] || v.words[0] != v.words[2] || v.words[0] != v.words[3];
+                backwards += (SingleWriter::value && v.words[0] < last) || version < last_version;
+                last = v.words[0];
+                last_version = version;
+            }
+        });
+
+    for(auto& t : writers)
+        t.join();
+    for(auto& t : readers)
+        t.join();
+
+    BOOST_CHECK_EQUAL(torn.load(), 0u);
+    BOOST_CHECK_EQUAL(backwards.load(), 0u);
+    BOOST_CHECK_EQUAL(cell.version(), WRITERS * N_MSG);
+    BOOST_CHECK_EQUAL(cell.load().words[0], N_MSG + 0u);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////